@@ -13,6 +13,7 @@ public class ManyMouse
     public native static synchronized void Quit();
     public native static synchronized String DeviceName(int index);
     public native static synchronized boolean PollEvent(ManyMouseEvent event);
+    public native static synchronized boolean WaitEvent(ManyMouseEvent event, int timeout);
 
     // JNI link.
     static { System.loadLibrary("ManyMouse"); }
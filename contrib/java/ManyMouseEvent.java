@@ -15,7 +15,12 @@ public class ManyMouseEvent
     public static final int BUTTON = 2;
     public static final int SCROLL = 3;
     public static final int DISCONNECT = 4;
-    public static final int MAX = 5;  // Only for reference: should not be set.
+    public static final int OVERFLOW = 5;
+    public static final int CONNECT = 6;
+    public static final int RELMOTION2D = 7;
+    public static final int ABSMOTION2D = 8;
+    public static final int TOUCH = 9;
+    public static final int MAX = 10;  // Only for reference: should not be set.
 
     public int type;
     public int device;
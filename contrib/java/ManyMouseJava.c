@@ -49,19 +49,11 @@ static jboolean setInt
 } /* setInt */
 
 
-JNIEXPORT jboolean JNICALL Java_ManyMouse_PollEvent
-  (JNIEnv *env, jclass obj, jobject jevent)
+static jboolean setEvent
+  (JNIEnv *env, jobject jevent, jclass cls, const ManyMouseEvent *event)
 {
-    ManyMouseEvent event;
-    jclass cls = (*env)->GetObjectClass(env, jevent);
-    if (cls == 0)
-        return JNI_FALSE;  /* !!! FIXME: throw an exception? */
-
-    if (ManyMouse_PollEvent(&event) == 0)
-        return JNI_FALSE;  /* no new events. */
-
     #define SETINT(field) \
-        if (!setInt(env, jevent, cls, #field, event.field)) return JNI_FALSE;
+        if (!setInt(env, jevent, cls, #field, event->field)) return JNI_FALSE;
     SETINT(type);
     SETINT(device);
     SETINT(item);
@@ -71,7 +63,37 @@ JNIEXPORT jboolean JNICALL Java_ManyMouse_PollEvent
     #undef SETINT
 
     return JNI_TRUE;
+} /* setEvent */
+
+
+JNIEXPORT jboolean JNICALL Java_ManyMouse_PollEvent
+  (JNIEnv *env, jclass obj, jobject jevent)
+{
+    ManyMouseEvent event;
+    jclass cls = (*env)->GetObjectClass(env, jevent);
+    if (cls == 0)
+        return JNI_FALSE;  /* !!! FIXME: throw an exception? */
+
+    if (ManyMouse_PollEvent(&event) == 0)
+        return JNI_FALSE;  /* no new events. */
+
+    return setEvent(env, jevent, cls, &event);
 } /* JNI org.icculus.ManyMouse.PollEvent */
 
+
+JNIEXPORT jboolean JNICALL Java_ManyMouse_WaitEvent
+  (JNIEnv *env, jclass obj, jobject jevent, jint timeout)
+{
+    ManyMouseEvent event;
+    jclass cls = (*env)->GetObjectClass(env, jevent);
+    if (cls == 0)
+        return JNI_FALSE;  /* !!! FIXME: throw an exception? */
+
+    if (ManyMouse_WaitEvent(&event, timeout) == 0)
+        return JNI_FALSE;  /* timed out. */
+
+    return setEvent(env, jevent, cls, &event);
+} /* JNI org.icculus.ManyMouse.WaitEvent */
+
 /* end of ManyMouseJava.c ... */
 
@@ -39,6 +39,14 @@ JNIEXPORT jstring JNICALL Java_ManyMouse_DeviceName
 JNIEXPORT jboolean JNICALL Java_ManyMouse_PollEvent
   (JNIEnv *, jclass, jobject);
 
+/*
+ * Class:     ManyMouse
+ * Method:    WaitEvent
+ * Signature: (LManyMouseEvent;I)Z
+ */
+JNIEXPORT jboolean JNICALL Java_ManyMouse_WaitEvent
+  (JNIEnv *, jclass, jobject, jint);
+
 #ifdef __cplusplus
 }
 #endif
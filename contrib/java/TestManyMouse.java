@@ -22,8 +22,9 @@ public class TestManyMouse
 
         while (mice > 0)  // report events until process is killed.
         {
-            if (!ManyMouse.PollEvent(event))
-                try { Thread.sleep(100); } catch (InterruptedException e) {}
+            // Sleeps in the native code until a mouse does something.
+            if (!ManyMouse.WaitEvent(event, -1))
+                break;  // only fails if ManyMouse itself is broken.
             else
             {
                 System.out.print("Mouse #");
@@ -86,6 +87,17 @@ public class TestManyMouse
                         mice--;
                         break;
 
+                    case ManyMouseEvent.CONNECT:
+                        System.out.print("connect");
+                        mice++;
+                        break;
+
+                    case ManyMouseEvent.OVERFLOW:
+                        System.out.print("overflow, ");
+                        System.out.print(event.value);
+                        System.out.print(" samples");
+                        break;
+
                     default:
                         System.out.print("Unknown event: ");
                         System.out.print(event.type);
@@ -12,9 +12,34 @@
 
 #include "manymouse.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+static double now_ms(void) { return (double) GetTickCount(); }
+#else
+#include <sys/time.h>
+static double now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (((double) tv.tv_sec) * 1000.0) + (((double) tv.tv_usec) / 1000.0);
+} /* now_ms */
+#endif
+
 int main(int argc, char **argv)
 {
-    const int available_mice = ManyMouse_Init();
+    /* "detect_mice evdev" skips straight to that driver. */
+    const double start = now_ms();
+    const int available_mice = (argc > 1) ? ManyMouse_InitDriver(argv[1], 0) :
+                                            ManyMouse_Init();
+    const double elapsed = now_ms() - start;
+    const char *drv;
+    int i;
+
+    printf("Drivers built in:");
+    for (i = 0; (drv = ManyMouse_ListDrivers(i)) != NULL; i++)
+        printf(" %s", drv);
+    printf("\n");
 
     if (available_mice < 0)
         printf("ManyMouse failed to initialize!\n");
@@ -22,15 +47,49 @@ int main(int argc, char **argv)
         printf("No mice detected!\n");
     else
     {
-        int i;
         printf("ManyMouse driver: %s\n", ManyMouse_DriverName());
         for (i = 0; i < available_mice; i++)
+        {
+            ManyMouseDeviceInfo info;
             printf("#%d: %s\n", i, ManyMouse_DeviceName(i));
+            if (ManyMouse_DeviceInfo(i, &info))
+            {
+                printf("    bus %04x vendor %04x product %04x version %04x\n",
+                       info.bustype, info.vendor, info.product, info.version);
+                if (info.node[0])
+                    printf("    node: %s\n", info.node);
+                if (info.phys[0])
+                    printf("    phys: %s\n", info.phys);
+                if (info.uniq[0])
+                    printf("    uniq: %s\n", info.uniq);
+                printf("    key: %016llx\n", info.key);
+            }
+        }
+    }
+
+    printf("Initialization took %.3f ms.\n", elapsed);
+
+#ifdef __linux__
+    /* evdev checks sysfs before opening nodes; show what that saves us. */
+    if ( (available_mice >= 0) && (getenv("MANYMOUSE_NO_SYSFS") == NULL) &&
+         (strstr(ManyMouse_DriverName(), "/dev/input") != NULL) )
+    {
+        double slow;
+        ManyMouse_Quit();
+        setenv("MANYMOUSE_NO_SYSFS", "1", 1);
+        slow = now_ms();
+        if (argc > 1)  /* same driver as last time, or we'd time X instead. */
+            ManyMouse_InitDriver(argv[1], 0);
+        else
+            ManyMouse_Init();
+        slow = now_ms() - slow;
+        unsetenv("MANYMOUSE_NO_SYSFS");
+        printf("Without the sysfs check, it took %.3f ms.\n", slow);
     }
+#endif
 
     ManyMouse_Quit();
     return 0;
 } /* main */
 
 /* end of detect_mice.c ... */
-
@@ -10,7 +10,7 @@
  * x86_64-w64-mingw32-gcc example/test_manymouse_sdl2.c manymouse.c windows_wminput.c x11_xinput2.c macosx_hidmanager.c macosx_hidutilities.c linux_evdev.c  -I./ -I"/usr/local/x86_64-w64-mingw32/include" -lSDL2main -lSDL2 -L/usr/local/x86_64-w64-mingw32/lib
  * 
  * Compile on linux with:
- * gcc example/test_manymouse_sdl2.c manymouse.c windows_wminput.c x11_xinput2.c macosx_hidmanager.c macosx_hidutilities.c linux_evdev.c  -I./ -lSDL2main -lSDL2
+ * gcc example/test_manymouse_sdl2.c manymouse.c windows_wminput.c x11_xinput2.c macosx_hidmanager.c macosx_hidutilities.c linux_evdev.c  -I./ -lSDL2main -lSDL2 -ldl -lpthread
  */
 
 #include <stdio.h>
@@ -47,66 +47,48 @@ static Mouse mice[MAX_MICE];
 
 static void update_mice(int screen_w, int screen_h)
 {
-    ManyMouseEvent event;
-    while (ManyMouse_PollEvent(&event))
+    const Uint32 now = SDL_GetTicks();
+    int i;
+
+    ManyMouse_Update();  /* the library tracks position and buttons for us. */
+
+    for (i = 0; i < available_mice; i++)
     {
-        Mouse *mouse;
-        if (event.device >= (unsigned int)available_mice)
+        ManyMouseDeviceState state;
+        Mouse *mouse = &mice[i];
+
+        if (!ManyMouse_GetDeviceState(i, &state))
             continue;
 
-        mouse = &mice[event.device];
+        mouse->connected = state.connected;
+        mouse->buttons = state.buttons;
 
-        if (event.type == MANYMOUSE_EVENT_RELMOTION)
+        if (state.maxx > state.minx)
         {
-            if (event.item == 0)
-                mouse->x += event.value;
-            else if (event.item == 1)
-                mouse->y += event.value;
+            float val = (float)(state.x - state.minx);
+            float maxval = (float)(state.maxx - state.minx);
+            mouse->x = (val / maxval) * screen_w;
         }
 
-        else if (event.type == MANYMOUSE_EVENT_ABSMOTION)
+        if (state.maxy > state.miny)
         {
-            float val = (float)(event.value - event.minval);
-            float maxval = (float)(event.maxval - event.minval);
-            if (event.item == 0)
-                mouse->x = (val / maxval) * screen_w;
-            else if (event.item == 1)
-                mouse->y = (val / maxval) * screen_h;
+            float val = (float)(state.y - state.miny);
+            float maxval = (float)(state.maxy - state.miny);
+            mouse->y = (val / maxval) * screen_h;
         }
 
-        else if (event.type == MANYMOUSE_EVENT_BUTTON)
-        {
-            if (event.item < 32)
-            {
-                if (event.value)
-                    mouse->buttons |= (1 << event.item);
-                else
-                    mouse->buttons &= ~(1 << event.item);
-            }
-        }
+        mouse->x += state.dx;
+        mouse->y += state.dy;
 
-        else if (event.type == MANYMOUSE_EVENT_SCROLL)
-        {
-            if (event.item == 0)
-            {
-                if (event.value < 0)
-                    mouse->scrolldowntick = SDL_GetTicks();
-                else
-                    mouse->scrolluptick = SDL_GetTicks();
-            }
-            else if (event.item == 1)
-            {
-                if (event.value < 0)
-                    mouse->scrolllefttick = SDL_GetTicks();
-                else
-                    mouse->scrollrighttick = SDL_GetTicks();
-            }
-        }
+        if (state.scroll_y < 0)
+            mouse->scrolldowntick = now;
+        else if (state.scroll_y > 0)
+            mouse->scrolluptick = now;
 
-        else if (event.type == MANYMOUSE_EVENT_DISCONNECT)
-        {
-            mice[event.device].connected = 0;
-        }
+        if (state.scroll_x < 0)
+            mouse->scrolllefttick = now;
+        else if (state.scroll_x > 0)
+            mouse->scrollrighttick = now;
     }
 }
 
@@ -15,7 +15,7 @@
 int main(int argc, char **argv)
 {
     ManyMouseEvent event;
-    const int available_mice = ManyMouse_Init();
+    const int available_mice = ManyMouse_InitEx(MANYMOUSE_INIT_HOTPLUG);
     int i;
 
     if (available_mice < 0)
@@ -39,54 +39,59 @@ int main(int argc, char **argv)
     printf("\n");
 
     printf("Use your mice, CTRL-C to exit.\n");
-    while (1)
+    /* sleeps until there's input, so we don't spin the CPU. */
+    while (ManyMouse_WaitEvent(&event, -1))
     {
-        while (ManyMouse_PollEvent(&event))
+        if (event.type == MANYMOUSE_EVENT_RELMOTION)
         {
-            if (event.type == MANYMOUSE_EVENT_RELMOTION)
-            {
-                printf("Mouse #%u relative motion %s %d\n", event.device,
-                        event.item == 0 ? "X" : "Y", event.value);
-            }
+            printf("Mouse #%u relative motion %s %d\n", event.device,
+                    event.item == 0 ? "X" : "Y", event.value);
+        }
 
-            else if (event.type == MANYMOUSE_EVENT_ABSMOTION)
-            {
-                printf("Mouse #%u absolute motion %s %d\n", event.device,
-                        event.item == 0 ? "X" : "Y", event.value);
-            }
+        else if (event.type == MANYMOUSE_EVENT_ABSMOTION)
+        {
+            printf("Mouse #%u absolute motion %s %d\n", event.device,
+                    event.item == 0 ? "X" : "Y", event.value);
+        }
 
-            else if (event.type == MANYMOUSE_EVENT_BUTTON)
-            {
-                printf("Mouse #%u button %u %s\n", event.device,
-                        event.item, event.value ? "down" : "up");
-            }
+        else if (event.type == MANYMOUSE_EVENT_BUTTON)
+        {
+            printf("Mouse #%u button %u %s\n", event.device,
+                    event.item, event.value ? "down" : "up");
+        }
 
-            else if (event.type == MANYMOUSE_EVENT_SCROLL)
+        else if (event.type == MANYMOUSE_EVENT_SCROLL)
+        {
+            const char *wheel;
+            const char *direction;
+            if (event.item == 0)
             {
-                const char *wheel;
-                const char *direction;
-                if (event.item == 0)
-                {
-                    wheel = "vertical";
-                    direction = ((event.value > 0) ? "up" : "down");
-                }
-                else
-                {
-                    wheel = "horizontal";
-                    direction = ((event.value > 0) ? "right" : "left");
-                }
-                printf("Mouse #%u wheel %s %s\n", event.device,
-                        wheel, direction);
+                wheel = "vertical";
+                direction = ((event.value > 0) ? "up" : "down");
             }
-
-            else if (event.type == MANYMOUSE_EVENT_DISCONNECT)
-                printf("Mouse #%u disconnect\n", event.device);
-
             else
             {
-                printf("Mouse #%u unhandled event type %d\n", event.device,
-                        event.type);
+                wheel = "horizontal";
+                direction = ((event.value > 0) ? "right" : "left");
             }
+            printf("Mouse #%u wheel %s %s\n", event.device,
+                    wheel, direction);
+        }
+
+        else if (event.type == MANYMOUSE_EVENT_DISCONNECT)
+            printf("Mouse #%u disconnect\n", event.device);
+
+        else if (event.type == MANYMOUSE_EVENT_CONNECT)
+            printf("Mouse #%u connect: %s\n", event.device,
+                    ManyMouse_DeviceName(event.device));
+
+        else if (event.type == MANYMOUSE_EVENT_OVERFLOW)
+            printf("Mouse #%u overflow, %d samples\n", event.device, event.value);
+
+        else
+        {
+            printf("Mouse #%u unhandled event type %d\n", event.device,
+                    event.type);
         }
     }
 
@@ -10,8 +10,11 @@
 
 #ifdef __linux__
 
+#include "manymouse_ring.h"
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <dirent.h>
@@ -20,305 +23,1777 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 
 #include <linux/input.h>  /* evdev interface...  */
 
 #define test_bit(array, bit)    (array[bit/8] & (1<<(bit%8)))
 
-/* linux allows 32 evdev nodes currently. */
-#define MAX_MICE 32
+/* newer headers hide (time) on 32-bit systems with a 64-bit time_t. */
+#ifndef input_event_sec
+#define input_event_sec time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+/* Linux 4.4 added this; older headers don't have it, older kernels fail it. */
+#ifndef EVIOCSMASK
+struct input_mask
+{
+    __u32 type;
+    __u32 codes_size;
+    __u64 codes_ptr;
+};
+#define EVIOCSMASK _IOW('E', 0x93, struct input_mask)
+#endif
+
+/* Linux 5.0 added these; wheel motion in 1/120ths of a click. */
+#ifndef REL_WHEEL_HI_RES
+#define REL_WHEEL_HI_RES 0x0b
+#define REL_HWHEEL_HI_RES 0x0c
+#endif
+#define HI_RES_DIVISOR 120
+
+/* Linux 3.x added this; older kernels fail it, so we skip touch resync. */
+#ifndef EVIOCGMTSLOTS
+#define EVIOCGMTSLOTS(len) _IOC(_IOC_READ, 'E', 0x0a, len)
+#endif
+
+/* epoll results we take per epoll_wait(). It's level-triggered, so the
+   rest are still there next time. */
+#define MAX_EPOLL_EVENTS 64
+
+/* Raw records we pull from the kernel per read(). A report is usually 3-4. */
+#define MAX_RECORDS 64
+
+/* Records we can make up to catch up after SYN_DROPPED. */
+#define MAX_SYNC_RECORDS 128
+
+/* Fingers we follow per multitouch device; more slots than this are ignored. */
+#define MAX_TOUCH_SLOTS 16
+
+/* The (item)s of ABS_MT_* records we map to MANYMOUSE_EVENT_TOUCH. */
+#define TOUCH_SLOT 0
+#define TOUCH_ID 1
+#define TOUCH_X 2
+#define TOUCH_Y 3
+
+/*
+ * What a raw (type, code) turns into: a ManyMouseEventType, an item and
+ *  a divisor (for SCROLL), or MAP_IGNORE. Each mouse gets its own tables, filled in by
+ *  build_record_maps() from what the device says it can do, so turning a
+ *  record into an event is just a lookup.
+ */
+#define MAP_IGNORE 0xFF
+
+typedef struct
+{
+    unsigned char type;
+    unsigned char item;
+    unsigned short divisor;
+} RecordMap;
+
+/*
+ * One multitouch slot. Changes pile up here until SYN_REPORT, and then go
+ *  out as TOUCH events; a contact that began and ended in one report is
+ *  never seen at all.
+ */
+typedef struct
+{
+    int id;  /* ABS_MT_TRACKING_ID of the finger here, or -1 if none. */
+    int lifted_id;  /* a finger that left this report, or -1... */
+    int lifted_x;  /* ...and where it was last. */
+    int lifted_y;
+    int x;
+    int y;
+    int began;  /* nonzero if (id) is new this report. */
+    int moved;  /* nonzero if (x, y) changed this report. */
+} TouchSlot;
+
 typedef struct
 {
     int fd;
-    int min_x;
-    int min_y;
-    int max_x;
-    int max_y;
+    RecordMap relmap[REL_CNT];
+    RecordMap absmap[ABS_CNT];
+    RecordMap keymap[KEY_CNT];
+    int absmin[ABS_CNT];  /* ranges of mapped absolute axes. */
+    int absmax[ABS_CNT];
+    dev_t rdev;  /* device node's id, so hotplug doesn't open it twice. */
+    int monotonic;  /* nonzero if the kernel timestamps with CLOCK_MONOTONIC. */
+    int grabbed;  /* nonzero if we have EVIOCGRAB on it. */
+    int queued;  /* nonzero if this mouse is in ready_mice[] right now. */
+    unsigned int record_pos;  /* next record in records[] to translate. */
+    unsigned int record_count;  /* records available in records[]. */
+    struct input_event records[MAX_RECORDS];
+    int dropping;  /* nonzero between SYN_DROPPED and the next SYN_REPORT. */
+    unsigned int sync_pos;  /* next record in sync[] to translate. */
+    unsigned int sync_count;  /* records available in sync[]. */
+    struct input_event sync[MAX_SYNC_RECORDS];  /* resync, see resync_mouse(). */
+    unsigned char keys[(KEY_MAX / 8) + 1];  /* buttons down, as we reported. */
+    int absval[ABS_CNT];  /* last absolute values we reported. */
+    ManyMouseEventEx frame[2];  /* frames mode: this report's rel and abs motion. */
+    int frame_done;  /* nonzero once the report is over and frame[] can go out. */
+    unsigned long long report_time;  /* when that report ended. */
+    unsigned int touch_slots;  /* slots in touches[] the device uses. */
+    unsigned int touch_slot;  /* slot ABS_MT_* records are about right now. */
+    unsigned int touch_dirty;  /* bit (n) is set if touches[n] changed. */
+    TouchSlot touches[MAX_TOUCH_SLOTS];
+    ManyMouseBacklog backlog;  /* threaded mode: motion held back by a full ring. */
+    /* counters for ManyMouse_DeviceStats(). Only the reading thread writes. */
+    atomic_ullong reports;
+    atomic_ullong records_read;
+    atomic_ullong ignored;
+    atomic_ullong drops;
+    ManyMouseDeviceInfo info;  /* for ManyMouse_DeviceInfo(). */
     char name[64];
 } MouseStruct;
 
-static MouseStruct mice[MAX_MICE];
-static unsigned int available_mice = 0;
+/*
+ * Hotplug: inotify tells us about new nodes in /dev/input, and we probe
+ *  just those. New mice get the next index, which is never reused, and
+ *  we report them with a CONNECT event once. Mice from linux_evdev_init()
+ *  are counted as announced already.
+ */
+#define HOTPLUG_INDEX 0xFFFFFFFE  /* epoll data for hotplug_fd, not a mouse. */
 
+/*
+ * Threaded mode: a background thread sleeps on the epoll set, translates
+ *  whatever the mice send, and hands the events to the app's thread
+ *  through a lock-free ring buffer (the reader thread is its producer, the
+ *  app's thread is its consumer). This keeps the kernel's buffers drained
+ *  even when the app stalls for a while, and polling from the app is just
+ *  a memory copy.
+ */
+#define MAX_THREAD_EVENTS 8192  /* must be a power of two. */
+#define WAKE_INDEX 0xFFFFFFFF  /* epoll data for wake_fd, not a mouse. */
 
-static int poll_mouse(MouseStruct *mouse, ManyMouseEvent *outevent)
+/*
+ * Everything one ManyMouse context has open. Every context opens the
+ *  device nodes itself, and the kernel gives each open fd its own copy of
+ *  the events, so contexts never see each other's reads.
+ */
+typedef struct
 {
-    int unhandled = 1;
-    while (unhandled)  /* read until failure or valid event. */
+    /*
+     * The device table grows as mice show up; there's no fixed limit.
+     *  Entries are separate allocations, so a MouseStruct never moves. In
+     *  threaded mode, hotplug grows the table from the reader thread, so
+     *  growing it and looking things up from the app's thread both hold
+     *  mice_lock. The reader thread is the only writer, so it reads
+     *  without the lock.
+     */
+    MouseStruct **mice;
+    unsigned int available_mice;
+    unsigned int mice_capacity;
+    int use_sysfs;  /* check capabilities in sysfs before open(). */
+    int use_evmask;  /* ask the kernel to filter out what we ignore. */
+    int use_frames;  /* MANYMOUSE_INIT_FRAMES: 2D motion per report. */
+    int use_grab;  /* MANYMOUSE_INIT_EXCLUSIVE: EVIOCGRAB every mouse. */
+    pthread_mutex_t mice_lock;
+    int epoll_fd;  /* watches every mouse's fd, so we can sleep. */
+    int hotplug_fd;
+    unsigned int announced_mice;
+
+    /*
+     * Mice the kernel says have data waiting, in the order we'll read them.
+     *  A mouse that gives us an event goes to the back of the line, so we
+     *  iterate through the busy mice round-robin. This prevents a chatty
+     *  mouse from dominating the queue, and idle mice cost us nothing at all.
+     */
+    unsigned int *ready_mice;  /* mice_capacity elements. */
+    unsigned int ready_head;
+    unsigned int ready_count;
+
+    /* threaded mode. */
+    ManyMouseRing thread_ring;
+    ManyMouseEventEx *thread_events;  /* MAX_THREAD_EVENTS elements. */
+    atomic_int thread_signalled;  /* nonzero if notify_fd was written. */
+    atomic_int thread_backlogged;  /* nonzero if a mouse has a backlog. */
+    atomic_int thread_quit;
+    int threaded;
+    pthread_t reader_thread;
+    int notify_fd;  /* eventfd: reader thread -> app's thread. */
+    int wake_fd;  /* eventfd: app's thread -> reader thread. */
+} ContextStruct;
+
+
+static unsigned long long timespec_ns(const struct timespec *ts)
+{
+    return (((unsigned long long) ts->tv_sec) * 1000000000ull) +
+           ((unsigned long long) ts->tv_nsec);
+} /* timespec_ns */
+
+static unsigned long long monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_ns(&ts);
+} /* monotonic_ns */
+
+static unsigned long long event_timestamp(const MouseStruct *mouse,
+                                          const struct input_event *event)
+{
+    const unsigned long long ns =
+        (((unsigned long long) event->input_event_sec) * 1000000000ull) +
+        (((unsigned long long) event->input_event_usec) * 1000ull);
+
+    if (!mouse->monotonic)  /* old kernel, wall clock time; map it over. */
     {
-        struct input_event event;
-        int br = read(mouse->fd, &event, sizeof (event));
-        if (br == -1)
-        {
-            if (errno == EAGAIN)
-                return 0;  /* just no new data at the moment. */
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (ns - timespec_ns(&ts)) + monotonic_ns();
+    } /* if */
 
-            /* mouse was unplugged? */
-            close(mouse->fd);  /* stop reading from this mouse. */
-            mouse->fd = -1;
-            outevent->type = MANYMOUSE_EVENT_DISCONNECT;
-            return 1;
-        } /* if */
+    return ns;
+} /* event_timestamp */
 
-        if (br != sizeof (event))
-            return 0;  /* oh well. */
 
-        unhandled = 0;  /* will reset if necessary. */
-        outevent->value = event.value;
-        if (event.type == EV_REL)
-        {
-            outevent->type = MANYMOUSE_EVENT_RELMOTION;
-            if ((event.code == REL_X) || (event.code == REL_DIAL))
-                outevent->item = 0;
-            else if (event.code == REL_Y)
-                outevent->item = 1;
+/* Turn a raw record into an event. Returns zero if it's not one we use. */
+static inline int translate_record(const MouseStruct *mouse,
+                                   const struct input_event *event,
+                                   ManyMouseEventEx *outevent)
+{
+    const unsigned int code = event->code;
+    const RecordMap *map;
 
-            else if (event.code == REL_WHEEL)
-            {
-                outevent->type = MANYMOUSE_EVENT_SCROLL;
-                outevent->item = 0;
-            } /* else if */
+    outevent->minval = outevent->maxval = 0;
+    outevent->value2 = outevent->minval2 = outevent->maxval2 = 0;
+    outevent->contact = 0;
+    if ((event->type == EV_REL) && (code < REL_CNT))
+        map = &mouse->relmap[code];
+    else if ((event->type == EV_KEY) && (code < KEY_CNT))
+        map = &mouse->keymap[code];
+    else if ((event->type == EV_ABS) && (code < ABS_CNT))
+    {
+        outevent->minval = mouse->absmin[code];
+        outevent->maxval = mouse->absmax[code];
+        map = &mouse->absmap[code];
+    } /* else if */
+    else
+        return 0;
 
-            else if (event.code == REL_HWHEEL)
-            {
-                outevent->type = MANYMOUSE_EVENT_SCROLL;
-                outevent->item = 1;
-            } /* else if */
+    if (map->type == MAP_IGNORE)
+        return 0;
 
-            else
-            {
-                unhandled = 1;
-            } /* else */
-        } /* if */
+    outevent->type = (ManyMouseEventType) map->type;
+    outevent->item = map->item;
+    outevent->value = event->value;
+    outevent->divisor = map->divisor;
+    return 1;
+} /* translate_record */
 
-        else if (event.type == EV_ABS)
-        {
-            outevent->type = MANYMOUSE_EVENT_ABSMOTION;
-            if (event.code == ABS_X)
-            {
-                outevent->item = 0;
-                outevent->minval = mouse->min_x;
-                outevent->maxval = mouse->max_x;
-            } /* if */
-            else if (event.code == ABS_Y)
-            {
-                outevent->item = 1;
-                outevent->minval = mouse->min_y;
-                outevent->maxval = mouse->max_y;
-            } /* if */
-            else
-            {
-                unhandled = 1;
-            } /* else */
-        } /* else if */
 
-        else if (event.type == EV_KEY)
-        {
-            outevent->type = MANYMOUSE_EVENT_BUTTON;
-            if ((event.code >= BTN_LEFT) && (event.code <= BTN_BACK))
-                outevent->item = event.code - BTN_MOUSE;
+/* Add to a ManyMouse_DeviceStats() counter. Single writer, so no RMW. */
+static inline void bump_counter(atomic_ullong *counter, const unsigned int amount)
+{
+    const unsigned long long val = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, val + amount, memory_order_relaxed);
+} /* bump_counter */
 
-            /* just in case some device uses this block of events instead... */
-            else if ((event.code >= BTN_MISC) && (event.code <= BTN_LEFT))
-                outevent->item = (event.code - BTN_MISC);
 
-            else if (event.code == BTN_TOUCH) /* tablet... */
-                outevent->item = 0;
-            else if (event.code == BTN_STYLUS) /* tablet... */
-                outevent->item = 1;
-            else if (event.code == BTN_STYLUS2) /* tablet... */
-                outevent->item = 2;
+/*
+ * Tell the kernel to only send us what translate_record() uses, so the
+ *  noise (MSC_SCAN, keys we don't map, axes we don't know) never costs us
+ *  a read() or a wakeup; a report that's all noise doesn't even wake us.
+ *  The masks come from asking translate_record() itself about every code.
+ *  Old kernels don't have EVIOCSMASK; they just keep sending everything.
+ */
+static void set_event_mask(const MouseStruct *mouse, const int fd)
+{
+    static const unsigned int types[] = { EV_KEY, EV_REL, EV_ABS };
+    unsigned char typebits[(EV_MAX / 8) + 1];
+    unsigned char codebits[(KEY_MAX / 8) + 1];  /* KEY_MAX is the biggest. */
+    struct input_mask mask;
+    struct input_event event;
+    ManyMouseEventEx dummy;
+    unsigned int i;
 
-            else
-            {
-                /*printf("unhandled mouse button: 0x%X\n", event.code);*/
-                unhandled = 1;
-            } /* else */
-        } /* else if */
-        else
+    memset(typebits, '\0', sizeof (typebits));
+    typebits[EV_SYN / 8] |= 1 << (EV_SYN % 8);  /* always sent anyhow. */
+    memset(&event, '\0', sizeof (event));
+
+    for (i = 0; i < (sizeof (types) / sizeof (types[0])); i++)
+    {
+        const unsigned int max = (types[i] == EV_KEY) ? KEY_MAX :
+                                 (types[i] == EV_REL) ? REL_MAX : ABS_MAX;
+        unsigned int code;
+
+        memset(codebits, '\0', sizeof (codebits));
+        event.type = types[i];
+        for (code = 0; code <= max; code++)
         {
-            unhandled = 1;
-        } /* else */
-    } /* while */
+            event.code = code;
+            if (translate_record(mouse, &event, &dummy))
+                codebits[code / 8] |= 1 << (code % 8);
+        } /* for */
 
-    return 1;  /* got a valid event */
-} /* poll_mouse */
+        mask.type = types[i];
+        mask.codes_size = (max / 8) + 1;
+        mask.codes_ptr = (__u64) (uintptr_t) codebits;
+        if (ioctl(fd, EVIOCSMASK, &mask) == -1)
+            return;  /* old kernel; we'll filter it ourselves. */
+
+        typebits[types[i] / 8] |= 1 << (types[i] % 8);
+    } /* for */
 
+    mask.type = 0;  /* zero means the mask of event types. */
+    mask.codes_size = sizeof (typebits);
+    mask.codes_ptr = (__u64) (uintptr_t) typebits;
+    ioctl(fd, EVIOCSMASK, &mask);
+} /* set_event_mask */
 
-static int init_mouse(const char *fname, int fd)
+
+/* Queue a made-up record for resync_mouse(). The last slot is for SYN_REPORT. */
+static void add_sync_record(MouseStruct *mouse, struct input_event *event,
+                            const unsigned int code, const int value)
 {
-    MouseStruct *mouse = &mice[available_mice];
-    int has_absolutes = 0;
-    int is_mouse = 0;
-    unsigned char relcaps[(REL_MAX / 8) + 1];
-    unsigned char abscaps[(ABS_MAX / 8) + 1];
-    unsigned char keycaps[(KEY_MAX / 8) + 1];
+    if (mouse->sync_count < MAX_SYNC_RECORDS - 1)
+    {
+        event->code = code;
+        event->value = value;
+        mouse->sync[mouse->sync_count++] = *event;
+    } /* if */
+} /* add_sync_record */
 
-    memset(relcaps, '\0', sizeof (relcaps));
-    memset(abscaps, '\0', sizeof (abscaps));
-    memset(keycaps, '\0', sizeof (keycaps));
+/*
+ * Catch up on every touch slot: EVIOCGMTSLOTS gives us one ABS_MT_* code
+ *  for all slots at once, so ask for ids and positions, and make up the
+ *  records that would have taken our slots from what we have to that.
+ */
+static void resync_touches(MouseStruct *mouse, struct input_event *event)
+{
+    static const unsigned int codes[3] = {
+        ABS_MT_TRACKING_ID, ABS_MT_POSITION_X, ABS_MT_POSITION_Y
+    };
+    int32_t vals[3][MAX_TOUCH_SLOTS + 1];  /* code, then a value per slot. */
+    struct input_absinfo absinfo;
+    unsigned int i;
 
-    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof (keycaps)), keycaps) == -1)
-        return 0;  /* gotta have some buttons!  :)  */
+    for (i = 0; i < 3; i++)
+    {
+        vals[i][0] = (int32_t) codes[i];
+        if (ioctl(mouse->fd, EVIOCGMTSLOTS(sizeof (vals[i])), vals[i]) == -1)
+            return;
+    } /* for */
 
-    if (ioctl(fd, EVIOCGBIT(EV_REL, sizeof (relcaps)), relcaps) != -1)
+    event->type = EV_ABS;
+    for (i = 0; i < mouse->touch_slots; i++)
     {
-    	if ( (test_bit(relcaps, REL_X)) && (test_bit(relcaps, REL_Y)) )
+        const TouchSlot *touch = &mouse->touches[i];
+        const int id = vals[0][i + 1];
+        if ( (id == touch->id) && ((id == -1) ||
+             ((vals[1][i + 1] == touch->x) && (vals[2][i + 1] == touch->y))) )
+            continue;  /* nothing we missed. */
+
+        add_sync_record(mouse, event, ABS_MT_SLOT, (int) i);
+        if (id != touch->id)
+            add_sync_record(mouse, event, ABS_MT_TRACKING_ID, id);
+        if (id != -1)
         {
-            if (test_bit(keycaps, BTN_MOUSE))
-                is_mouse = 1;
+            add_sync_record(mouse, event, ABS_MT_POSITION_X, vals[1][i + 1]);
+            add_sync_record(mouse, event, ABS_MT_POSITION_Y, vals[2][i + 1]);
         } /* if */
+    } /* for */
 
-        #if ALLOW_DIALS_TO_BE_MICE
-    	if (test_bit(relcaps, REL_DIAL))
-            is_mouse = 1;  // griffin powermate?
-        #endif
-    } /* if */
+    /* leave us pointed at whatever slot the kernel thinks is current. */
+    if (ioctl(mouse->fd, EVIOCGABS(ABS_MT_SLOT), &absinfo) != -1)
+        add_sync_record(mouse, event, ABS_MT_SLOT, absinfo.value);
+} /* resync_touches */
+
+/*
+ * The kernel overflowed this client's buffer (SYN_DROPPED), so we lost
+ *  records, maybe a button release. We've thrown away everything up to
+ *  the next SYN_REPORT; now ask the kernel what the buttons, absolute
+ *  axes and touches look like right now, and make up records for whatever
+ *  differs from what we last reported. Lost relative motion is just gone.
+ */
+static void resync_mouse(MouseStruct *mouse)
+{
+    unsigned char keys[(KEY_MAX / 8) + 1];
+    struct input_event event;
+    ManyMouseEventEx dummy;
+    struct timespec ts;
+    unsigned int code;
+
+    mouse->sync_pos = mouse->sync_count = 0;
 
-    if (ioctl(fd, EVIOCGBIT(EV_ABS, sizeof (abscaps)), abscaps) != -1)
+    /* stamp them with now, on the clock the kernel stamps this fd with. */
+    memset(&event, '\0', sizeof (event));
+    clock_gettime(mouse->monotonic ? CLOCK_MONOTONIC : CLOCK_REALTIME, &ts);
+    event.input_event_sec = ts.tv_sec;
+    event.input_event_usec = ts.tv_nsec / 1000;
+
+    memset(keys, '\0', sizeof (keys));
+    if (ioctl(mouse->fd, EVIOCGKEY(sizeof (keys)), keys) != -1)
     {
-        if ( (test_bit(abscaps, ABS_X)) && (test_bit(abscaps, ABS_Y)) )
+        event.type = EV_KEY;
+        for (code = 0; code <= KEY_MAX; code++)
         {
-            /* might be a touchpad... */
-            if (test_bit(keycaps, BTN_TOUCH))
-            {
-                is_mouse = 1;  /* touchpad, touchscreen, or tablet. */
-                has_absolutes = 1;
-            } /* if */
-        } /* if */
+            const int down = test_bit(keys, code) ? 1 : 0;
+            if (down == (test_bit(mouse->keys, code) ? 1 : 0))
+                continue;
+            event.code = code;
+            if (translate_record(mouse, &event, &dummy))
+                add_sync_record(mouse, &event, code, down);
+        } /* for */
     } /* if */
 
-    if (!is_mouse)
-        return 0;
-
-    mouse->min_x = mouse->min_y = mouse->max_x = mouse->max_y = 0;
-    if (has_absolutes)
+    event.type = EV_ABS;
+    for (code = 0; code < ABS_CNT; code++)
     {
         struct input_absinfo absinfo;
-        if (ioctl(fd, EVIOCGABS(ABS_X), &absinfo) == -1)
-            return 0;
-        mouse->min_x = absinfo.minimum;
-        mouse->max_x = absinfo.maximum;
+        event.code = code;
+        event.value = 0;
+        if (!translate_record(mouse, &event, &dummy))
+            continue;  /* don't care about this axis. */
+        else if (dummy.type == MANYMOUSE_EVENT_TOUCH)
+            continue;  /* per slot; resync_touches() does these. */
+        else if (ioctl(mouse->fd, EVIOCGABS(code), &absinfo) == -1)
+            continue;
+        else if (absinfo.value == mouse->absval[code])
+            continue;
+        add_sync_record(mouse, &event, code, absinfo.value);
+    } /* for */
 
-        if (ioctl(fd, EVIOCGABS(ABS_Y), &absinfo) == -1)
-            return 0;
-        mouse->min_y = absinfo.minimum;
-        mouse->max_y = absinfo.maximum;
+    if (mouse->touch_slots > 0)
+        resync_touches(mouse, &event);
+
+    /* it's a report of its own, so frames and touches go out right away. */
+    if (mouse->sync_count > 0)
+    {
+        event.type = EV_SYN;
+        event.code = SYN_REPORT;
+        event.value = 0;
+        mouse->sync[mouse->sync_count++] = event;
     } /* if */
+} /* resync_mouse */
 
-    if (ioctl(fd, EVIOCGNAME(sizeof (mouse->name)), mouse->name) == -1)
-        snprintf(mouse->name, sizeof (mouse->name), "Unknown device");
 
-    mouse->fd = fd;
+/*
+ * Frames mode: motion for x and y is held in frame[] until the report's
+ *  SYN_REPORT, and then goes out as one 2D event per kind of motion, with
+ *  (item) saying which axes moved. Returns zero if (event) isn't held.
+ */
+static int add_to_frame(MouseStruct *mouse, const ManyMouseEventEx *event)
+{
+    ManyMouseEventEx *frame;
 
-    return 1;  /* we're golden. */
-} /* init_mouse */
+    if (event->item > 1)
+        return 0;
+    else if (event->type == MANYMOUSE_EVENT_RELMOTION)
+    {
+        frame = &mouse->frame[0];
+        frame->type = MANYMOUSE_EVENT_RELMOTION2D;
+        if (event->item == 0)
+            frame->value += event->value;
+        else
+            frame->value2 += event->value;
+    } /* else if */
+    else if (event->type == MANYMOUSE_EVENT_ABSMOTION)
+    {
+        frame = &mouse->frame[1];
+        frame->type = MANYMOUSE_EVENT_ABSMOTION2D;
+        if (event->item == 0)
+        {
+            frame->value = event->value;
+            frame->minval = event->minval;
+            frame->maxval = event->maxval;
+        } /* if */
+        else
+        {
+            frame->value2 = event->value;
+            frame->minval2 = event->minval;
+            frame->maxval2 = event->maxval;
+        } /* else */
+    } /* else if */
+    else
+        return 0;
 
+    frame->item |= 1 << event->item;
+    return 1;
+} /* add_to_frame */
 
-/* Return a file descriptor if this is really a mouse, -1 otherwise. */
-static int open_if_mouse(const char *fname)
+/* Apply an ABS_MT_* record, already translated to a TOUCH_* (item). */
+static void update_touch(MouseStruct *mouse, const unsigned int item,
+                         const int value)
 {
-    struct stat statbuf;
-    int fd;
-    int devmajor, devminor;
+    TouchSlot *touch;
 
-    if (stat(fname, &statbuf) == -1)
-        return 0;
+    if (item == TOUCH_SLOT)
+    {
+        mouse->touch_slot = (unsigned int) value;  /* negative is out of range, too. */
+        return;
+    } /* if */
+    else if (mouse->touch_slot >= mouse->touch_slots)
+        return;  /* a slot we don't follow. */
 
-    if (S_ISCHR(statbuf.st_mode) == 0)
-        return 0;  /* not a character device... */
+    touch = &mouse->touches[mouse->touch_slot];
+    if (item == TOUCH_ID)
+    {
+        if (value == touch->id)
+            return;
+        else if ((touch->id != -1) && (!touch->began))
+        {
+            touch->lifted_id = touch->id;  /* someone saw it; say it's gone. */
+            touch->lifted_x = touch->x;
+            touch->lifted_y = touch->y;
+        } /* else if */
+        touch->id = value;
+        touch->began = (value != -1);
+        touch->moved = 0;
+    } /* if */
+    else if (item == TOUCH_X)
+    {
+        touch->x = value;
+        touch->moved = 1;
+    } /* else if */
+    else if (item == TOUCH_Y)
+    {
+        touch->y = value;
+        touch->moved = 1;
+    } /* else if */
 
-    /* evdev node ids are major 13, minor 64-96. Is this safe to check? */
-    devmajor = (statbuf.st_rdev & 0xFF00) >> 8;
-    devminor = (statbuf.st_rdev & 0x00FF);
-    if ( (devmajor != 13) || (devminor < 64) || (devminor > 96) )
-        return 0;  /* not an evdev. */
+    mouse->touch_dirty |= 1u << mouse->touch_slot;
+} /* update_touch */
 
-    if ((fd = open(fname, O_RDONLY | O_NONBLOCK)) == -1)
-        return 0;
+/* Hand out the next TOUCH event for a finished report, if there is one. */
+static int take_touch(MouseStruct *mouse, ManyMouseEventEx *outevent)
+{
+    while (mouse->touch_dirty)
+    {
+        const unsigned int i = (unsigned int) __builtin_ctz(mouse->touch_dirty);
+        TouchSlot *touch = &mouse->touches[i];
+        ManyMouseTouchPhase phase;
+        int contact;
+        int x = touch->x;
+        int y = touch->y;
+
+        if (touch->lifted_id != -1)
+        {
+            phase = MANYMOUSE_TOUCH_END;
+            contact = touch->lifted_id;
+            x = touch->lifted_x;
+            y = touch->lifted_y;
+            touch->lifted_id = -1;
+        } /* if */
+        else if (touch->began)
+        {
+            phase = MANYMOUSE_TOUCH_BEGIN;
+            contact = touch->id;
+            touch->began = touch->moved = 0;
+        } /* else if */
+        else if ((touch->moved) && (touch->id != -1))
+        {
+            phase = MANYMOUSE_TOUCH_MOVE;
+            contact = touch->id;
+            touch->moved = 0;
+        } /* else if */
+        else
+        {
+            touch->moved = 0;
+            mouse->touch_dirty &= ~(1u << i);  /* all said; next slot. */
+            continue;
+        } /* else */
 
-    if (init_mouse(fname, fd))
+        memset(outevent, '\0', sizeof (*outevent));
+        outevent->type = MANYMOUSE_EVENT_TOUCH;
+        outevent->item = phase;
+        outevent->contact = contact;
+        outevent->value = x;
+        outevent->minval = mouse->absmin[ABS_MT_POSITION_X];
+        outevent->maxval = mouse->absmax[ABS_MT_POSITION_X];
+        outevent->value2 = y;
+        outevent->minval2 = mouse->absmin[ABS_MT_POSITION_Y];
+        outevent->maxval2 = mouse->absmax[ABS_MT_POSITION_Y];
+        outevent->timestamp = mouse->report_time;
         return 1;
+    } /* while */
 
-    close(fd);
     return 0;
-} /* open_if_mouse */
+} /* take_touch */
 
-
-static int linux_evdev_init(void)
+/*
+ * Hand out the next event held for the end of the report: 2D motion
+ *  first, then touches. Returns zero once there are none.
+ */
+static int take_frame(MouseStruct *mouse, ManyMouseEventEx *outevent)
 {
-    DIR *dirp;
-    struct dirent *dent;
-    int i;
-
-    for (i = 0; i < MAX_MICE; i++)
-        mice[i].fd = -1;
-
-    dirp = opendir("/dev/input");
-    if (!dirp)
-        return -1;
-
-    while ((dent = readdir(dirp)) != NULL)
+    unsigned int i;
+    for (i = 0; i < 2; i++)
     {
-        char fname[128];
-        snprintf(fname, sizeof (fname), "/dev/input/%s", dent->d_name);
-        if (open_if_mouse(fname))
-            available_mice++;
-    } /* while */
+        if (mouse->frame[i].item)
+        {
+            memcpy(outevent, &mouse->frame[i], sizeof (*outevent));
+            memset(&mouse->frame[i], '\0', sizeof (mouse->frame[i]));
+            outevent->timestamp = mouse->report_time;
+            return 1;
+        } /* if */
+    } /* for */
 
-    closedir(dirp);
+    if (take_touch(mouse, outevent))
+        return 1;
 
-    return available_mice;
-} /* linux_evdev_init */
+    mouse->frame_done = 0;
+    return 0;
+} /* take_frame */
 
 
-static void linux_evdev_quit(void)
+/* Stop reading from (mouse), and let go of it if we grabbed it. */
+static void close_mouse(MouseStruct *mouse)
 {
-    while (available_mice)
+    if (mouse->grabbed)
     {
-        int fd = mice[available_mice--].fd;
-        if (fd != -1)
-            close(fd);
-    } /* while */
-} /* linux_evdev_quit */
+        ioctl(mouse->fd, EVIOCGRAB, 0);  /* close() would, but say so. */
+        mouse->grabbed = 0;
+    } /* if */
+    close(mouse->fd);
+    mouse->fd = -1;
+} /* close_mouse */
 
 
-static const char *linux_evdev_name(unsigned int index)
+static int poll_mouse(ContextStruct *ctx, MouseStruct *mouse,
+                      ManyMouseEventEx *outevent)
 {
-    return (index < available_mice) ? mice[index].name : NULL;
-} /* linux_evdev_name */
-
+    int unhandled = 1;
+    while (unhandled)  /* read until failure or valid event. */
+    {
+        struct input_event event;
+        int made_up = 0;
 
-static int linux_evdev_poll(ManyMouseEvent *event)
-{
-    /*
-     * (i) is static so we iterate through all mice round-robin. This
-     *  prevents a chatty mouse from dominating the queue.
-     */
-    static unsigned int i = 0;
+        /* the last report's motion, if it's done. */
+        if ((mouse->frame_done) && (take_frame(mouse, outevent)))
+            return 1;
 
-    if (i >= available_mice)
-        i = 0;  /* handle reset condition. */
+        /* made-up records from resync_mouse() go next. */
+        if (mouse->sync_pos < mouse->sync_count)
+        {
+            memcpy(&event, &mouse->sync[mouse->sync_pos++], sizeof (event));
+            made_up = 1;
+        } /* if */
 
-    if (event != NULL)
-    {
-        while (i < available_mice)
+        /*
+         * Pull everything the kernel has for us in one read(), and then
+         *  translate it a record at a time as the app asks for events.
+         */
+        else
         {
-            MouseStruct *mouse = &mice[i];
-            if (mouse->fd != -1)
+            if (mouse->record_pos >= mouse->record_count)
             {
-                if (poll_mouse(mouse, event))
+                const int br = read(mouse->fd, mouse->records, sizeof (mouse->records));
+                mouse->record_pos = mouse->record_count = 0;
+                if (br == -1)
                 {
-                    event->device = i;
+                    if (errno == EAGAIN)
+                        return 0;  /* just no new data at the moment. */
+
+                    /* mouse was unplugged? */
+                    close_mouse(mouse);  /* stop reading from this mouse. */
+                    memset(outevent, '\0', sizeof (*outevent));
+                    outevent->type = MANYMOUSE_EVENT_DISCONNECT;
+                    outevent->timestamp = monotonic_ns();
                     return 1;
                 } /* if */
+
+                /* evdev only hands out whole records, so this is exact. */
+                mouse->record_count = ((unsigned int) br) / sizeof (event);
+                if (mouse->record_count == 0)
+                    return 0;  /* oh well. */
+                bump_counter(&mouse->records_read, mouse->record_count);
             } /* if */
-            i++;
-        } /* while */
+
+            memcpy(&event, &mouse->records[mouse->record_pos++], sizeof (event));
+        } /* else */
+
+        if ((event.type == EV_SYN) && (event.code == SYN_DROPPED))
+        {
+            bump_counter(&mouse->drops, 1);
+            mouse->dropping = 1;  /* junk until the next report. */
+            memset(mouse->frame, '\0', sizeof (mouse->frame));
+            continue;
+        } /* if */
+
+        else if ((event.type == EV_SYN) && (event.code == SYN_REPORT))
+        {
+            if (!made_up)
+                bump_counter(&mouse->reports, 1);
+
+            if (!mouse->dropping)
+            {
+                if ((ctx->use_frames) || (mouse->touch_dirty))
+                {
+                    /* one timestamp for the whole report: when it ended. */
+                    mouse->report_time = event_timestamp(mouse, &event);
+                    mouse->frame_done = 1;
+                } /* if */
+                continue;
+            } /* if */
+
+            /* caught up. Tell the app, then fix what it missed. */
+            mouse->dropping = 0;
+            resync_mouse(mouse);
+            outevent->type = MANYMOUSE_EVENT_OVERFLOW;
+            outevent->item = 1;  /* the kernel's buffer, not ours. */
+            outevent->value = 0;  /* it doesn't say how many. */
+            outevent->minval = outevent->maxval = 0;
+            outevent->value2 = outevent->minval2 = outevent->maxval2 = 0;
+            outevent->divisor = outevent->contact = 0;
+            outevent->timestamp = event_timestamp(mouse, &event);
+            return 1;
+        } /* else if */
+
+        else if (mouse->dropping)
+        {
+            bump_counter(&mouse->ignored, 1);
+            continue;
+        } /* else if */
+
+        unhandled = !translate_record(mouse, &event, outevent);
+        if (unhandled)
+        {
+            bump_counter(&mouse->ignored, 1);
+            continue;
+        } /* if */
+        else if (outevent->type == MANYMOUSE_EVENT_TOUCH)
+        {
+            update_touch(mouse, outevent->item, event.value);
+            unhandled = 1;  /* goes out at the end of the report. */
+            continue;
+        } /* else if */
+
+        outevent->timestamp = event_timestamp(mouse, &event);
+
+        /* remember what we told the app, for resync_mouse(). */
+        if ((event.type == EV_KEY) && (event.code <= KEY_MAX))
+        {
+            if (event.value)
+                mouse->keys[event.code / 8] |= (1 << (event.code % 8));
+            else
+                mouse->keys[event.code / 8] &= ~(1 << (event.code % 8));
+        } /* if */
+        else if ((event.type == EV_ABS) && (event.code < ABS_CNT))
+            mouse->absval[event.code] = event.value;
+
+        if ((ctx->use_frames) && (add_to_frame(mouse, outevent)))
+            unhandled = 1;  /* goes out with the rest of the report. */
+    } /* while */
+
+    return 1;  /* got a valid event */
+} /* poll_mouse */
+
+
+/* Make room for one more mouse. Returns zero if we're out of memory. */
+static int grow_mice(ContextStruct *ctx)
+{
+    const unsigned int newcap = ctx->mice_capacity ? (ctx->mice_capacity * 2) : 16;
+    MouseStruct **newmice;
+    unsigned int *newready;
+    unsigned int i;
+
+    if (ctx->available_mice < ctx->mice_capacity)
+        return 1;  /* already have room. */
+
+    newmice = (MouseStruct **) malloc(newcap * sizeof (MouseStruct *));
+    newready = (unsigned int *) malloc(newcap * sizeof (unsigned int));
+    if ((newmice == NULL) || (newready == NULL))
+    {
+        free(newmice);
+        free(newready);
+        return 0;
     } /* if */
 
-    return 0;  /* no new events */
-} /* linux_evdev_poll */
+    for (i = 0; i < ctx->available_mice; i++)
+        newmice[i] = ctx->mice[i];
+
+    /* the ready list wraps at the capacity, so straighten it out. */
+    for (i = 0; i < ctx->ready_count; i++)
+        newready[i] = ctx->ready_mice[(ctx->ready_head + i) % ctx->mice_capacity];
+
+    pthread_mutex_lock(&ctx->mice_lock);
+    free(ctx->mice);
+    free(ctx->ready_mice);
+    ctx->mice = newmice;
+    ctx->ready_mice = newready;
+    ctx->ready_head = 0;
+    ctx->mice_capacity = newcap;
+    pthread_mutex_unlock(&ctx->mice_lock);
+
+    return 1;
+} /* grow_mice */
+
+
+/* Decide if capability bitmaps (as EVIOCGBIT reports them) are a mouse's. */
+static int caps_are_mouse(const unsigned char *relcaps,
+                          const unsigned char *abscaps,
+                          const unsigned char *keycaps,
+                          int *has_absolutes)
+{
+    int is_mouse = 0;
+
+    *has_absolutes = 0;
+
+    if ( (test_bit(relcaps, REL_X)) && (test_bit(relcaps, REL_Y)) )
+    {
+        if (test_bit(keycaps, BTN_MOUSE))
+            is_mouse = 1;
+    } /* if */
+
+    #if ALLOW_DIALS_TO_BE_MICE
+    if (test_bit(relcaps, REL_DIAL))
+        is_mouse = 1;  // griffin powermate?
+    #endif
+
+    if ( (test_bit(abscaps, ABS_X)) && (test_bit(abscaps, ABS_Y)) )
+    {
+        /* might be a touchpad... */
+        if (test_bit(keycaps, BTN_TOUCH))
+        {
+            is_mouse = 1;  /* touchpad, touchscreen, or tablet. */
+            *has_absolutes = 1;
+        } /* if */
+    } /* if */
+
+    return is_mouse;
+} /* caps_are_mouse */
+
+
+/*
+ * sysfs has the same bitmaps EVIOCGBIT gives us, so we can throw out
+ *  keyboards, joysticks, etc without opening them (which can mean waking
+ *  the hardware up). The kernel prints them as hex longs, most significant
+ *  first, using its own size of a long. That's only surely the same as
+ *  ours if we're 64-bit, since 32-bit processes run on 64-bit kernels.
+ */
+static int read_sysfs_caps(const char *node, const char *cap,
+                           unsigned char *bits, const size_t len)
+{
+    const char *words[64];
+    char buf[1024];
+    char path[128];
+    char *ptr;
+    unsigned int total = 0;
+    unsigned int i;
+    ssize_t br;
+    int fd;
+
+    if (sizeof (long) != 8)
+        return 0;  /* can't trust our word size, see above. */
+
+    snprintf(path, sizeof (path), "/sys/class/input/%s/device/capabilities/%s", node, cap);
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+        return 0;
+    br = read(fd, buf, sizeof (buf) - 1);
+    close(fd);
+    if (br <= 0)
+        return 0;
+    buf[br] = '\0';
+
+    for (ptr = buf; (*ptr) && (total < 64); )
+    {
+        while ((*ptr == ' ') || (*ptr == '\n'))
+            ptr++;
+        if (*ptr)
+            words[total++] = ptr;
+        while ((*ptr) && (*ptr != ' ') && (*ptr != '\n'))
+            ptr++;
+    } /* for */
+
+    memset(bits, '\0', len);
+    for (i = 0; i < total; i++)
+    {
+        const unsigned long word = strtoul(words[total - 1 - i], NULL, 16);
+        unsigned int j;
+        for (j = 0; j < sizeof (long); j++)
+        {
+            const size_t byte = (i * sizeof (long)) + j;
+            if (byte < len)
+                bits[byte] = (unsigned char) ((word >> (j * 8)) & 0xFF);
+        } /* for */
+    } /* for */
+
+    return 1;
+} /* read_sysfs_caps */
+
+/* Returns -1 if sysfs can't tell us, 0 if it's not a mouse, 1 if it might be. */
+static int sysfs_says_mouse(const char *node)
+{
+    unsigned char relcaps[(REL_MAX / 8) + 1];
+    unsigned char abscaps[(ABS_MAX / 8) + 1];
+    unsigned char keycaps[(KEY_MAX / 8) + 1];
+    int has_absolutes;
+
+    if ( (!read_sysfs_caps(node, "key", keycaps, sizeof (keycaps))) ||
+         (!read_sysfs_caps(node, "rel", relcaps, sizeof (relcaps))) ||
+         (!read_sysfs_caps(node, "abs", abscaps, sizeof (abscaps))) )
+        return -1;
+
+    return caps_are_mouse(relcaps, abscaps, keycaps, &has_absolutes);
+} /* sysfs_says_mouse */
+
+
+static inline void map_record(RecordMap *map, const unsigned char *caps,
+                              const unsigned int code,
+                              const ManyMouseEventType type,
+                              const unsigned int item)
+{
+    if (test_bit(caps, code))
+    {
+        map[code].type = (unsigned char) type;
+        map[code].item = (unsigned char) item;
+        map[code].divisor = (type == MANYMOUSE_EVENT_SCROLL) ? 1 : 0;
+    } /* if */
+} /* map_record */
+
+/* Fill in (mouse)'s record maps for what the device can actually do. */
+static int build_record_maps(MouseStruct *mouse, const int fd,
+                             const unsigned char *relcaps,
+                             const unsigned char *abscaps,
+                             const unsigned char *keycaps,
+                             const int has_absolutes)
+{
+    int extra_buttons = 0;  /* where BTN_0 goes. */
+    unsigned int code;
+
+    memset(mouse->relmap, MAP_IGNORE, sizeof (mouse->relmap));
+    memset(mouse->absmap, MAP_IGNORE, sizeof (mouse->absmap));
+    memset(mouse->keymap, MAP_IGNORE, sizeof (mouse->keymap));
+
+    map_record(mouse->relmap, relcaps, REL_X, MANYMOUSE_EVENT_RELMOTION, 0);
+    map_record(mouse->relmap, relcaps, REL_Y, MANYMOUSE_EVENT_RELMOTION, 1);
+    map_record(mouse->relmap, relcaps, REL_DIAL, MANYMOUSE_EVENT_RELMOTION, 0);
+    map_record(mouse->relmap, relcaps, REL_WHEEL, MANYMOUSE_EVENT_SCROLL, 0);
+    map_record(mouse->relmap, relcaps, REL_HWHEEL, MANYMOUSE_EVENT_SCROLL, 1);
+
+    /* hi-res wheels send both kinds for the same motion; keep the fine one. */
+    if (test_bit(relcaps, REL_WHEEL_HI_RES))
+    {
+        map_record(mouse->relmap, relcaps, REL_WHEEL_HI_RES, MANYMOUSE_EVENT_SCROLL, 0);
+        mouse->relmap[REL_WHEEL_HI_RES].divisor = HI_RES_DIVISOR;
+        mouse->relmap[REL_WHEEL].type = MAP_IGNORE;
+    } /* if */
+
+    if (test_bit(relcaps, REL_HWHEEL_HI_RES))
+    {
+        map_record(mouse->relmap, relcaps, REL_HWHEEL_HI_RES, MANYMOUSE_EVENT_SCROLL, 1);
+        mouse->relmap[REL_HWHEEL_HI_RES].divisor = HI_RES_DIVISOR;
+        mouse->relmap[REL_HWHEEL].type = MAP_IGNORE;
+    } /* if */
+
+    map_record(mouse->absmap, abscaps, ABS_X, MANYMOUSE_EVENT_ABSMOTION, 0);
+    map_record(mouse->absmap, abscaps, ABS_Y, MANYMOUSE_EVENT_ABSMOTION, 1);
+
+    /* multitouch, if it's the kind with slots. */
+    if ( (test_bit(abscaps, ABS_MT_SLOT)) &&
+         (test_bit(abscaps, ABS_MT_TRACKING_ID)) &&
+         (test_bit(abscaps, ABS_MT_POSITION_X)) &&
+         (test_bit(abscaps, ABS_MT_POSITION_Y)) )
+    {
+        map_record(mouse->absmap, abscaps, ABS_MT_SLOT, MANYMOUSE_EVENT_TOUCH, TOUCH_SLOT);
+        map_record(mouse->absmap, abscaps, ABS_MT_TRACKING_ID, MANYMOUSE_EVENT_TOUCH, TOUCH_ID);
+        map_record(mouse->absmap, abscaps, ABS_MT_POSITION_X, MANYMOUSE_EVENT_TOUCH, TOUCH_X);
+        map_record(mouse->absmap, abscaps, ABS_MT_POSITION_Y, MANYMOUSE_EVENT_TOUCH, TOUCH_Y);
+    } /* if */
+
+    for (code = 0; code < ABS_CNT; code++)
+    {
+        struct input_absinfo absinfo;
+        mouse->absmin[code] = mouse->absmax[code] = 0;
+        if (mouse->absmap[code].type == MAP_IGNORE)
+            continue;
+        else if (ioctl(fd, EVIOCGABS(code), &absinfo) != -1)
+        {
+            mouse->absmin[code] = absinfo.minimum;
+            mouse->absmax[code] = absinfo.maximum;
+            if (code == ABS_MT_SLOT)  /* slots are 0 to maximum. */
+            {
+                mouse->touch_slots = (unsigned int) (absinfo.maximum + 1);
+                if (mouse->touch_slots > MAX_TOUCH_SLOTS)
+                    mouse->touch_slots = MAX_TOUCH_SLOTS;
+                mouse->touch_slot = (unsigned int) absinfo.value;
+            } /* if */
+        } /* else if */
+        else if (has_absolutes)
+            return 0;  /* this is what makes it a mouse, and it's broken. */
+    } /* for */
+
+    for (code = 0; code < MAX_TOUCH_SLOTS; code++)
+        mouse->touches[code].id = mouse->touches[code].lifted_id = -1;
+
+    /* left, right, middle, side, extra, forward, back, task... */
+    for (code = BTN_MOUSE; code <= BTN_TASK; code++)
+    {
+        map_record(mouse->keymap, keycaps, code, MANYMOUSE_EVENT_BUTTON, code - BTN_MOUSE);
+        if (test_bit(keycaps, code))
+            extra_buttons = (BTN_TASK - BTN_MOUSE) + 1;
+    } /* for */
+
+    /* ...then BTN_0 and up after those, or on their own if that's all. */
+    for (code = BTN_0; code <= BTN_9; code++)
+        map_record(mouse->keymap, keycaps, code, MANYMOUSE_EVENT_BUTTON, extra_buttons + (code - BTN_0));
+
+    /* tablets. */
+    map_record(mouse->keymap, keycaps, BTN_TOUCH, MANYMOUSE_EVENT_BUTTON, 0);
+    map_record(mouse->keymap, keycaps, BTN_STYLUS, MANYMOUSE_EVENT_BUTTON, 1);
+    map_record(mouse->keymap, keycaps, BTN_STYLUS2, MANYMOUSE_EVENT_BUTTON, 2);
+
+    return 1;
+} /* build_record_maps */
+
+
+static int init_mouse(ContextStruct *ctx, MouseStruct *mouse,
+                      const char *fname, int fd)
+{
+    int has_absolutes = 0;
+    unsigned char relcaps[(REL_MAX / 8) + 1];
+    unsigned char abscaps[(ABS_MAX / 8) + 1];
+    unsigned char keycaps[(KEY_MAX / 8) + 1];
+
+    memset(relcaps, '\0', sizeof (relcaps));
+    memset(abscaps, '\0', sizeof (abscaps));
+    memset(keycaps, '\0', sizeof (keycaps));
+
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof (keycaps)), keycaps) == -1)
+        return 0;  /* gotta have some buttons!  :)  */
+
+    /* if these fail, the bitmaps stay empty, which is the right answer. */
+    ioctl(fd, EVIOCGBIT(EV_REL, sizeof (relcaps)), relcaps);
+    ioctl(fd, EVIOCGBIT(EV_ABS, sizeof (abscaps)), abscaps);
+
+    if (!caps_are_mouse(relcaps, abscaps, keycaps, &has_absolutes))
+        return 0;
+
+    if (!build_record_maps(mouse, fd, relcaps, abscaps, keycaps, has_absolutes))
+        return 0;
+
+    if (ioctl(fd, EVIOCGNAME(sizeof (mouse->name)), mouse->name) == -1)
+        snprintf(mouse->name, sizeof (mouse->name), "Unknown device");
+
+    /* what it is and where it's plugged in, so apps can find it next time. */
+    {
+        ManyMouseDeviceInfo *info = &mouse->info;
+        struct input_id id;
+        memset(info, '\0', sizeof (*info));
+        info->system_id = -1;
+        if (ioctl(fd, EVIOCGID, &id) != -1)
+        {
+            info->bustype = id.bustype;
+            info->vendor = id.vendor;
+            info->product = id.product;
+            info->version = id.version;
+        } /* if */
+        if (ioctl(fd, EVIOCGPHYS(sizeof (info->phys) - 1), info->phys) == -1)
+            info->phys[0] = '\0';
+        if (ioctl(fd, EVIOCGUNIQ(sizeof (info->uniq) - 1), info->uniq) == -1)
+            info->uniq[0] = '\0';
+        snprintf(info->node, sizeof (info->node), "%s", fname);
+    }
+
+    /* ask for CLOCK_MONOTONIC timestamps instead of wall clock time. */
+    mouse->monotonic = 0;
+    #ifdef EVIOCSCLOCKID
+    {
+        int clockid = CLOCK_MONOTONIC;
+        if (ioctl(fd, EVIOCSCLOCKID, &clockid) != -1)
+            mouse->monotonic = 1;
+    }
+    #endif
+
+    if (ctx->use_evmask)
+        set_event_mask(mouse, fd);
+
+    if (ctx->epoll_fd != -1)
+    {
+        struct epoll_event ev;
+        memset(&ev, '\0', sizeof (ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = ctx->available_mice;
+        if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+            return 0;
+    } /* if */
+
+    /*
+     * Exclusive mode: nobody else (X, Wayland, the console) gets events
+     *  from this mouse while we have it. If someone else grabbed it first,
+     *  we can still read it; we just don't have it to ourselves.
+     */
+    mouse->grabbed = 0;
+    if ((ctx->use_grab) && (ioctl(fd, EVIOCGRAB, 1) != -1))
+        mouse->grabbed = 1;
+
+    mouse->fd = fd;
+    mouse->record_pos = mouse->record_count = 0;
+
+    return 1;  /* we're golden. */
+} /* init_mouse */
+
+
+/*
+ * Add (fname) to the table if it's really a mouse. Returns nonzero if it
+ *  was. Only hotplug needs (check_dupes); a fresh scan can't see a node
+ *  twice, and skipping the check keeps startup linear.
+ */
+static int open_if_mouse(ContextStruct *ctx, const char *fname,
+                         const int check_dupes)
+{
+    const char *node = strrchr(fname, '/');
+    struct stat statbuf;
+    MouseStruct *mouse;
+    int version = 0;
+    int fd;
+    unsigned int i;
+
+    if ((ctx->use_sysfs) && (sysfs_says_mouse(node ? node + 1 : fname) == 0))
+        return 0;  /* don't bother opening it. */
+
+    if (stat(fname, &statbuf) == -1)
+        return 0;
+
+    if (S_ISCHR(statbuf.st_mode) == 0)
+        return 0;  /* not a character device... */
+
+    if (check_dupes)
+    {
+        for (i = 0; i < ctx->available_mice; i++)
+        {
+            if ((ctx->mice[i]->fd != -1) && (ctx->mice[i]->rdev == statbuf.st_rdev))
+                return 0;  /* already have it. */
+        } /* for */
+    } /* if */
+
+    if (!grow_mice(ctx))
+        return 0;
+
+    if ((fd = open(fname, O_RDONLY | O_NONBLOCK)) == -1)
+        return 0;
+
+    /* evdev minors aren't a fixed range anymore; ask the driver itself. */
+    if (ioctl(fd, EVIOCGVERSION, &version) == -1)
+    {
+        close(fd);
+        return 0;  /* not an evdev. */
+    } /* if */
+
+    mouse = (MouseStruct *) calloc(1, sizeof (MouseStruct));
+    if (mouse == NULL)
+    {
+        close(fd);
+        return 0;
+    } /* if */
+
+    mouse->fd = -1;
+    if (!init_mouse(ctx, mouse, fname, fd))
+    {
+        free(mouse);
+        close(fd);
+        return 0;
+    } /* if */
+
+    mouse->rdev = statbuf.st_rdev;
+
+    pthread_mutex_lock(&ctx->mice_lock);
+    ctx->mice[ctx->available_mice++] = mouse;
+    pthread_mutex_unlock(&ctx->mice_lock);
+
+    return 1;
+} /* open_if_mouse */
+
+
+/* Open every mouse in /dev/input we don't have yet. */
+static int scan_for_mice(ContextStruct *ctx, const int check_dupes)
+{
+    DIR *dirp = opendir("/dev/input");
+    struct dirent *dent;
+
+    if (!dirp)
+        return 0;
+
+    while ((dent = readdir(dirp)) != NULL)
+    {
+        char fname[128];
+        if (strncmp(dent->d_name, "event", 5) != 0)
+            continue;  /* mice, js0, by-id, etc. */
+        snprintf(fname, sizeof (fname), "/dev/input/%s", dent->d_name);
+        open_if_mouse(ctx, fname, check_dupes);
+    } /* while */
+
+    closedir(dirp);
+    return 1;
+} /* scan_for_mice */
+
+static void start_hotplug(ContextStruct *ctx)
+{
+    struct epoll_event ev;
+
+    if (ctx->epoll_fd == -1)
+        return;  /* nothing would ever notice. */
+
+    ctx->hotplug_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (ctx->hotplug_fd == -1)
+        return;
+
+    /*
+     * udev usually creates the node before it fixes its permissions, so
+     *  the first open() can fail; IN_ATTRIB catches the second chance.
+     */
+    memset(&ev, '\0', sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = HOTPLUG_INDEX;
+    if ( (inotify_add_watch(ctx->hotplug_fd, "/dev/input", IN_CREATE | IN_ATTRIB) == -1) ||
+         (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, ctx->hotplug_fd, &ev) == -1) )
+    {
+        close(ctx->hotplug_fd);
+        ctx->hotplug_fd = -1;
+    } /* if */
+} /* start_hotplug */
+
+/* Probe whatever showed up in /dev/input since last time. */
+static void check_hotplug(ContextStruct *ctx)
+{
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+
+    while ((len = read(ctx->hotplug_fd, buf, sizeof (buf))) > 0)
+    {
+        const char *ptr = buf;
+        while (ptr < buf + len)
+        {
+            const struct inotify_event *ev = (const struct inotify_event *) ptr;
+            ptr += sizeof (struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW)
+                scan_for_mice(ctx, 1);  /* lost track; just look at everything. */
+            else if ((ev->len > 0) && (strncmp(ev->name, "event", 5) == 0))
+            {
+                char fname[128];
+                snprintf(fname, sizeof (fname), "/dev/input/%s", ev->name);
+                open_if_mouse(ctx, fname, 1);
+            } /* else if */
+        } /* while */
+    } /* while */
+} /* check_hotplug */
+
+static void make_connect_event(ManyMouseEventEx *event, const unsigned int index)
+{
+    struct timespec ts;
+    memset(event, '\0', sizeof (*event));
+    event->version = MANYMOUSE_EVENTEX_VERSION;
+    event->type = MANYMOUSE_EVENT_CONNECT;
+    event->device = index;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        event->timestamp = timespec_ns(&ts);
+} /* make_connect_event */
+
+
+static void queue_ready_mouse(ContextStruct *ctx, const unsigned int index)
+{
+    MouseStruct *mouse = ctx->mice[index];
+    if ((!mouse->queued) && (mouse->fd != -1))
+    {
+        ctx->ready_mice[(ctx->ready_head + ctx->ready_count) % ctx->mice_capacity] = index;
+        ctx->ready_count++;
+        mouse->queued = 1;
+    } /* if */
+} /* queue_ready_mouse */
+
+/* Take the mouse at the front of the line; see ready_mice. */
+static unsigned int next_ready_mouse(ContextStruct *ctx)
+{
+    const unsigned int index = ctx->ready_mice[ctx->ready_head];
+    ctx->ready_head = (ctx->ready_head + 1) % ctx->mice_capacity;
+    ctx->ready_count--;
+    ctx->mice[index]->queued = 0;
+    return index;
+} /* next_ready_mouse */
+
+/* Reader thread: sleep until the app pops something, or we're quitting. */
+static void wait_for_room(ContextStruct *ctx, const unsigned int reserve)
+{
+    struct pollfd pfd;
+    unsigned long long val;
+
+    /* ask the app to wake us when it pops something; see thread_poll_batch(). */
+    atomic_store(&ctx->thread_backlogged, 1);
+    if (manymouse_ring_space(&ctx->thread_ring) > reserve)
+        return;  /* it already did, before it could see the flag. */
+
+    pfd.fd = ctx->wake_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, -1) > 0)
+    {
+        if (read(ctx->wake_fd, &val, sizeof (val)) == -1)
+            { /* EAGAIN is fine, it's already reset. */ }
+    } /* if */
+} /* wait_for_room */
+
+/*
+ * The reader thread stops reading once the ring's free space is down to
+ *  the reserve, and leaves the rest with the kernel until the app catches
+ *  up, so buttons, scrolling and disconnects are never dropped. Mice it
+ *  stopped partway through wait in ready_mice[] (which only this thread
+ *  uses in threaded mode), since epoll won't mention records we already
+ *  pulled into records[].
+ */
+static void *reader_thread_main(void *_ctx)
+{
+    ContextStruct *ctx = (ContextStruct *) _ctx;
+    struct epoll_event evs[MAX_EPOLL_EVENTS];
+    ManyMouseEventEx event;
+    int backlogged = 0;  /* nonzero if any mouse might have a backlog. */
+
+    while (!atomic_load(&ctx->thread_quit))
+    {
+        ManyMouseRing *ring = &ctx->thread_ring;
+        const unsigned int reserve = MANYMOUSE_RING_RESERVE(ring);
+        unsigned int turns;
+        int queued = 0;
+        int rc;
+        int i;
+
+        if (manymouse_ring_space(ring) <= reserve)
+        {
+            wait_for_room(ctx, reserve);
+            continue;
+        } /* if */
+
+        /* don't sleep if we left a mouse partway through. */
+        rc = epoll_wait(ctx->epoll_fd, evs, MAX_EPOLL_EVENTS,
+                        (ctx->ready_count > 0) ? 0 : -1);
+
+        for (i = 0; i < rc; i++)
+        {
+            const unsigned int index = evs[i].data.u32;
+            if (index == WAKE_INDEX)
+            {
+                /* quitting, or the app made room for our backlog. */
+                unsigned long long val;
+                if (read(ctx->wake_fd, &val, sizeof (val)) == -1)
+                    { /* EAGAIN is fine, it's already reset. */ }
+            } /* if */
+            else if (index == HOTPLUG_INDEX)
+                check_hotplug(ctx);
+            else if (index < ctx->available_mice)
+                queue_ready_mouse(ctx, index);
+        } /* for */
+
+        while ((ctx->announced_mice < ctx->available_mice) &&
+               (manymouse_ring_space(ring) > reserve))
+        {
+            MouseStruct *newmouse = ctx->mice[ctx->announced_mice];
+            make_connect_event(&event, ctx->announced_mice++);
+            queued += manymouse_ring_queue(ring, &newmouse->backlog, &event);
+        } /* while */
+
+        /* a turn's worth per mouse; busy ones go to the back of the line. */
+        for (turns = ctx->ready_count; turns > 0; turns--)
+        {
+            const unsigned int index = next_ready_mouse(ctx);
+            MouseStruct *mouse = ctx->mice[index];
+            int total = 0;
+
+            while (mouse->fd != -1)
+            {
+                if ((total >= MAX_RECORDS) || (manymouse_ring_space(ring) <= reserve))
+                {
+                    queue_ready_mouse(ctx, index);  /* might have more. */
+                    break;
+                } /* if */
+                else if (!poll_mouse(ctx, mouse, &event))
+                    break;  /* drained; epoll will tell us when it has more. */
+
+                event.version = MANYMOUSE_EVENTEX_VERSION;
+                event.device = index;
+                if (manymouse_ring_queue(ring, &mouse->backlog, &event))
+                    queued++;
+                else
+                    backlogged = 1;
+                total++;
+            } /* while */
+        } /* for */
+
+        /* held motion goes in as soon as there's room above the reserve. */
+        if (backlogged)
+        {
+            backlogged = 0;
+            for (i = 0; i < (int) ctx->available_mice; i++)
+            {
+                ManyMouseBacklog *backlog = &ctx->mice[i]->backlog;
+                if (manymouse_backlog_pending(backlog))
+                {
+                    if (manymouse_ring_flush(ring, backlog, i, reserve))
+                        queued++;
+                    else
+                        backlogged = 1;
+                } /* if */
+            } /* for */
+
+            /* ask the app to wake us when it pops something; see thread_poll_batch(). */
+            if (backlogged)
+                atomic_store(&ctx->thread_backlogged, 1);
+        } /* if */
+
+        /* only poke the app once until it notices; see thread_poll_batch(). */
+        if ((queued) && (!atomic_exchange(&ctx->thread_signalled, 1)))
+        {
+            const unsigned long long val = 1;
+            if (write(ctx->notify_fd, &val, sizeof (val)) == -1)
+                { /* not much we can do; the app will find it on next poll. */ }
+        } /* if */
+    } /* while */
+
+    return NULL;
+} /* reader_thread_main */
+
+static void stop_reader_thread(ContextStruct *ctx)
+{
+    if (ctx->threaded)
+    {
+        const unsigned long long val = 1;
+        atomic_store(&ctx->thread_quit, 1);
+        if (write(ctx->wake_fd, &val, sizeof (val)) == -1)
+            pthread_cancel(ctx->reader_thread);  /* ugh. Shouldn't happen. */
+        /* either way, it has to be gone before we free what it's using. */
+        pthread_join(ctx->reader_thread, NULL);
+        ctx->threaded = 0;
+    } /* if */
+
+    if (ctx->notify_fd != -1)
+    {
+        close(ctx->notify_fd);
+        ctx->notify_fd = -1;
+    } /* if */
+
+    if (ctx->wake_fd != -1)
+    {
+        close(ctx->wake_fd);
+        ctx->wake_fd = -1;
+    } /* if */
+
+    free(ctx->thread_events);
+    ctx->thread_events = NULL;
+} /* stop_reader_thread */
+
+static int start_reader_thread(ContextStruct *ctx)
+{
+    struct epoll_event ev;
+
+    if (ctx->epoll_fd == -1)
+        return 0;
+
+    ctx->thread_events = (ManyMouseEventEx *) malloc(MAX_THREAD_EVENTS * sizeof (ManyMouseEventEx));
+    if (ctx->thread_events == NULL)
+        return 0;
+
+    manymouse_ring_init(&ctx->thread_ring, ctx->thread_events, MAX_THREAD_EVENTS);
+    atomic_store(&ctx->thread_signalled, 0);
+    atomic_store(&ctx->thread_backlogged, 0);
+    atomic_store(&ctx->thread_quit, 0);
+
+    ctx->notify_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    ctx->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if ((ctx->notify_fd == -1) || (ctx->wake_fd == -1))
+    {
+        stop_reader_thread(ctx);
+        return 0;
+    } /* if */
+
+    memset(&ev, '\0', sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = WAKE_INDEX;
+    if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, ctx->wake_fd, &ev) == -1)
+    {
+        stop_reader_thread(ctx);
+        return 0;
+    } /* if */
+
+    if (pthread_create(&ctx->reader_thread, NULL, reader_thread_main, ctx) != 0)
+    {
+        epoll_ctl(ctx->epoll_fd, EPOLL_CTL_DEL, ctx->wake_fd, &ev);
+        stop_reader_thread(ctx);
+        return 0;
+    } /* if */
+
+    ctx->threaded = 1;
+    return 1;
+} /* start_reader_thread */
+
+static int thread_poll_batch(ContextStruct *ctx, ManyMouseEventEx *events,
+                             unsigned int max)
+{
+    unsigned int count = manymouse_ring_pop(&ctx->thread_ring, events, max);
+
+    /*
+     * Ran dry? Reset notify_fd so apps waiting on it don't spin, then look
+     *  again, since the reader thread might have added more in the meantime
+     *  and not written to notify_fd because we hadn't reset it yet.
+     */
+    if ((count < max) && (atomic_exchange(&ctx->thread_signalled, 0)))
+    {
+        unsigned long long val;
+        if (read(ctx->notify_fd, &val, sizeof (val)) == -1)
+            { /* EAGAIN is fine, it's already reset. */ }
+        count += manymouse_ring_pop(&ctx->thread_ring, events + count, max - count);
+    } /* if */
+
+    /* we made room; if the reader thread is holding motion back, poke it. */
+    if ((count > 0) && (atomic_exchange(&ctx->thread_backlogged, 0)))
+    {
+        const unsigned long long val = 1;
+        if (write(ctx->wake_fd, &val, sizeof (val)) == -1)
+            { /* it'll flush when the next event arrives, then. */ }
+    } /* if */
+
+    return (int) count;
+} /* thread_poll_batch */
+
+
+static void linux_evdev_quit(void *instance);
+
+static int linux_evdev_init(void **instance, unsigned int flags)
+{
+    ContextStruct *ctx;
+    void *ptr = NULL;
+
+    /* thread_ring wants its indices on their own cache lines. */
+    if (posix_memalign(&ptr, MANYMOUSE_CACHELINE, sizeof (*ctx)) != 0)
+        return -1;
+    ctx = (ContextStruct *) ptr;
+
+    memset(ctx, '\0', sizeof (*ctx));
+    pthread_mutex_init(&ctx->mice_lock, NULL);
+    ctx->hotplug_fd = ctx->notify_fd = ctx->wake_fd = -1;
+
+    /* for comparing startup times, mostly. See detect_mice.c. */
+    ctx->use_sysfs = (getenv("MANYMOUSE_NO_SYSFS") == NULL);
+    ctx->use_evmask = (getenv("MANYMOUSE_NO_EVMASK") == NULL);
+    ctx->use_frames = ((flags & MANYMOUSE_INIT_FRAMES) != 0);
+    ctx->use_grab = ((flags & MANYMOUSE_INIT_EXCLUSIVE) != 0);
+
+    /* if this fails, we can still poll; we just can't wait for input. */
+    ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    /* watch before scanning, so nothing slips in between. */
+    if (flags & MANYMOUSE_INIT_HOTPLUG)
+        start_hotplug(ctx);
+
+    if (!scan_for_mice(ctx, 0))
+    {
+        linux_evdev_quit(ctx);
+        return -1;
+    } /* if */
+
+    ctx->announced_mice = ctx->available_mice;
+
+    /* if the thread won't start, we'll still work, just unthreaded. */
+    if (flags & MANYMOUSE_INIT_THREADED)
+        start_reader_thread(ctx);
+
+    *instance = ctx;
+    return ctx->available_mice;
+} /* linux_evdev_init */
+
+
+static void linux_evdev_quit(void *instance)
+{
+    ContextStruct *ctx = (ContextStruct *) instance;
+
+    stop_reader_thread(ctx);  /* must go before we close any fds! */
+
+    while (ctx->available_mice)
+    {
+        MouseStruct *mouse = ctx->mice[--ctx->available_mice];
+        if (mouse->fd != -1)
+            close_mouse(mouse);
+        free(mouse);
+    } /* while */
+
+    free(ctx->mice);
+    free(ctx->ready_mice);
+    ctx->mice = NULL;
+    ctx->ready_mice = NULL;
+    ctx->mice_capacity = 0;
+
+    if (ctx->hotplug_fd != -1)
+    {
+        close(ctx->hotplug_fd);
+        ctx->hotplug_fd = -1;
+    } /* if */
+
+    if (ctx->epoll_fd != -1)
+    {
+        close(ctx->epoll_fd);
+        ctx->epoll_fd = -1;
+    } /* if */
+
+    pthread_mutex_destroy(&ctx->mice_lock);
+    free(ctx);
+} /* linux_evdev_quit */
+
+
+static const char *linux_evdev_name(void *instance, unsigned int index)
+{
+    ContextStruct *ctx = (ContextStruct *) instance;
+    const char *retval = NULL;
+    pthread_mutex_lock(&ctx->mice_lock);
+    if (index < ctx->available_mice)
+        retval = ctx->mice[index]->name;
+    pthread_mutex_unlock(&ctx->mice_lock);
+    return retval;
+} /* linux_evdev_name */
+
+
+static int linux_evdev_stats(void *instance, unsigned int index,
+                             ManyMouseStats *stats)
+{
+    ContextStruct *ctx = (ContextStruct *) instance;
+    MouseStruct *mouse = NULL;
+
+    pthread_mutex_lock(&ctx->mice_lock);
+    if (index < ctx->available_mice)
+        mouse = ctx->mice[index];
+    pthread_mutex_unlock(&ctx->mice_lock);
+
+    if (mouse == NULL)
+        return 0;
+
+    stats->reports = atomic_load_explicit(&mouse->reports, memory_order_relaxed);
+    stats->records = atomic_load_explicit(&mouse->records_read, memory_order_relaxed);
+    stats->ignored = atomic_load_explicit(&mouse->ignored, memory_order_relaxed);
+    stats->drops = atomic_load_explicit(&mouse->drops, memory_order_relaxed);
+    return 1;
+} /* linux_evdev_stats */
+
+
+static int linux_evdev_info(void *instance, unsigned int index,
+                            ManyMouseDeviceInfo *info)
+{
+    ContextStruct *ctx = (ContextStruct *) instance;
+    int retval = 0;
+    pthread_mutex_lock(&ctx->mice_lock);
+    if (index < ctx->available_mice)
+    {
+        memcpy(info, &ctx->mice[index]->info, sizeof (*info));
+        retval = 1;
+    } /* if */
+    pthread_mutex_unlock(&ctx->mice_lock);
+    return retval;
+} /* linux_evdev_info */
+
+
+/* Ask the kernel which mice have something to say. */
+static void find_ready_mice(ContextStruct *ctx)
+{
+    struct epoll_event evs[MAX_EPOLL_EVENTS];
+    unsigned int i;
+    int rc;
+
+    if (ctx->epoll_fd == -1)  /* can't ask? Check everything like we used to. */
+    {
+        for (i = 0; i < ctx->available_mice; i++)
+            queue_ready_mouse(ctx, i);
+        return;
+    } /* if */
+
+    rc = epoll_wait(ctx->epoll_fd, evs, MAX_EPOLL_EVENTS, 0);
+    for (i = 0; ((int) i) < rc; i++)
+    {
+        if (evs[i].data.u32 == HOTPLUG_INDEX)
+            check_hotplug(ctx);
+        else
+            queue_ready_mouse(ctx, evs[i].data.u32);
+    } /* for */
+} /* find_ready_mice */
+
+static int linux_evdev_poll_batch(void *instance, ManyMouseEventEx *events,
+                                  unsigned int max)
+{
+    ContextStruct *ctx = (ContextStruct *) instance;
+    unsigned int count = 0;
+    int asked = 0;
+
+    if (ctx->threaded)
+        return thread_poll_batch(ctx, events, max);
+
+    while (count < max)
+    {
+        unsigned int index;
+        MouseStruct *mouse;
+
+        if (ctx->announced_mice < ctx->available_mice)  /* hotplugged? Say so first. */
+        {
+            make_connect_event(&events[count++], ctx->announced_mice++);
+            continue;
+        } /* if */
+
+        if (ctx->ready_count == 0)
+        {
+            /* only ask once per call, in case a mouse lies about being ready. */
+            if (asked)
+                break;
+            find_ready_mice(ctx);
+            asked = 1;
+            if (ctx->ready_count == 0)
+                break;  /* nothing new from anyone. */
+        } /* if */
+
+        index = next_ready_mouse(ctx);
+        mouse = ctx->mice[index];
+        if ((mouse->fd != -1) && (poll_mouse(ctx, mouse, &events[count])))
+        {
+            events[count].version = MANYMOUSE_EVENTEX_VERSION;
+            events[count++].device = index;
+            queue_ready_mouse(ctx, index);  /* might have more; back of the line. */
+        } /* if */
+
+        /* else it's drained; epoll will tell us when it has more. */
+    } /* while */
+
+    return (int) count;
+} /* linux_evdev_poll_batch */
+
+
+static int linux_evdev_wait(void *instance, int timeout_ms)
+{
+    ContextStruct *ctx = (ContextStruct *) instance;
+    struct epoll_event ev;
+    int rc;
+
+    if (ctx->threaded)
+    {
+        struct pollfd pfd;
+        if (manymouse_ring_count(&ctx->thread_ring) > 0)
+            return 1;  /* already have something. */
+        pfd.fd = ctx->notify_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        rc = poll(&pfd, 1, timeout_ms);
+    } /* if */
+
+    else if (ctx->epoll_fd == -1)
+        return -1;
+    else if ((ctx->ready_count > 0) || (ctx->announced_mice < ctx->available_mice))
+        return 1;  /* may have records the kernel already handed us. */
+    else  /* Unplugged mice are closed, which drops them from the epoll set. */
+        rc = epoll_wait(ctx->epoll_fd, &ev, 1, timeout_ms);
+
+    if (rc == -1)
+        return (errno == EINTR) ? 1 : -1;  /* signals just wake us early. */
+
+    return rc;
+} /* linux_evdev_wait */
+
+
+static int linux_evdev_readiness_fd(void *instance)
+{
+    const ContextStruct *ctx = (const ContextStruct *) instance;
+    if (ctx->threaded)
+        return ctx->notify_fd;  /* reader thread pokes this when it has events. */
+    return ctx->epoll_fd;  /* epoll fds are pollable themselves. */
+} /* linux_evdev_readiness_fd */
+
 
 static const ManyMouseDriver ManyMouseDriver_interface =
 {
@@ -326,7 +1801,12 @@ static const ManyMouseDriver ManyMouseDriver_interface =
     linux_evdev_init,
     linux_evdev_quit,
     linux_evdev_name,
-    linux_evdev_poll
+    NULL,  /* we only do batches. */
+    linux_evdev_poll_batch,
+    linux_evdev_wait,
+    linux_evdev_readiness_fd,
+    linux_evdev_stats,
+    linux_evdev_info
 };
 
 const ManyMouseDriver *ManyMouseDriver_evdev = &ManyMouseDriver_interface;
@@ -17,6 +17,14 @@
 #  if MAC_OS_X_VERSION_MAX_ALLOWED >= MAC_OS_X_VERSION_10_5
 #    define MANYMOUSE_DO_MAC_10_POINT_5_API 1
 #  endif
+
+/*
+ * Nonzero while either Mac driver is running. Both read the same HID
+ *  devices and keep everything in statics, so only one of them runs at a
+ *  time, in one context; the other one mustn't start up in a second
+ *  context instead. macosx_hidutilities.c uses this, too.
+ */
+int manymouse_macosx_hid_in_use = 0;
 #endif
 
 #if MANYMOUSE_DO_MAC_10_POINT_5_API
@@ -341,7 +349,7 @@ static int create_hidmanager(const UInt32 page, const UInt32 usage)
 
 /* ManyMouseDriver interface... */
 
-static void macosx_hidmanager_quit(void)
+static void macosx_hidmanager_quit(void *instance)
 {
     unsigned int i;
     for (i = 0; i < physical_mice; i++)
@@ -362,20 +370,25 @@ static void macosx_hidmanager_quit(void)
 
     memset(input_events, '\0', sizeof (input_events));
     input_events_read = input_events_write = 0;
+    manymouse_macosx_hid_in_use = 0;
 } /* macosx_hidmanager_quit */
 
 
-static int macosx_hidmanager_init(void)
+static int macosx_hidmanager_init(void **instance, unsigned int flags)
 {
     if (IOHIDManagerCreate == NULL)
         return -1;  /* weak symbol is NULL...we don't have OS X >= 10.5.0 */
+    else if (manymouse_macosx_hid_in_use)
+        return -1;  /* everything's static; there can only be one. */
 
-    macosx_hidmanager_quit();  /* just in case... */
+    macosx_hidmanager_quit(NULL);  /* just in case... */
 
     /* Prepare global (hidman), (mice), (physical_mice), etc. */
     if (!create_hidmanager(kHIDPage_GenericDesktop, kHIDUsage_GD_Mouse))
         return -1;
 
+    *instance = NULL;
+    manymouse_macosx_hid_in_use = 1;
     return (int) logical_mice;
 } /* macosx_hidmanager_init */
 
@@ -396,14 +409,14 @@ static MouseStruct *map_logical_device(const unsigned int index)
     return NULL;  /* not found (maybe unplugged?) */
 } /* map_logical_device */
 
-static const char *macosx_hidmanager_name(unsigned int index)
+static const char *macosx_hidmanager_name(void *instance, unsigned int index)
 {
     const MouseStruct *mouse = map_logical_device(index);
     return mouse ? mouse->name : NULL;
 } /* macosx_hidmanager_name */
 
 
-static int macosx_hidmanager_poll(ManyMouseEvent *event)
+static int macosx_hidmanager_poll(void *instance, ManyMouseEvent *event)
 {
     /* ...favor existing events in the queue... */
     if (dequeue_event(event))
@@ -423,7 +436,12 @@ static const ManyMouseDriver ManyMouseDriver_interface =
     macosx_hidmanager_init,
     macosx_hidmanager_quit,
     macosx_hidmanager_name,
-    macosx_hidmanager_poll
+    macosx_hidmanager_poll,
+    NULL,  /* no native batch polling. */
+    NULL,  /* no native waiting. */
+    NULL,  /* no readiness fd. */
+    NULL,  /* no stats. */
+    NULL   /* no device info. */
 };
 
 const ManyMouseDriver *ManyMouseDriver_hidmanager = &ManyMouseDriver_interface;
@@ -1468,6 +1468,7 @@ static unsigned long  HIDQueueDevice (pRecDevice pDevice)
 static int logical_mice = 0;
 static int physical_mice = 0;
 static pRecDevice *devices = NULL;
+extern int manymouse_macosx_hid_in_use;  /* see macosx_hidmanager.c. */
 
 static inline int is_trackpad(const pRecDevice dev)
 {
@@ -1570,7 +1571,7 @@ static int poll_mouse(pRecDevice mouse, ManyMouseEvent *outevent)
 } /* poll_mouse */
 
 
-static void macosx_hidutilities_quit(void)
+static void macosx_hidutilities_quit(void *instance)
 {
     HIDReleaseAllDeviceQueues();
     HIDReleaseDeviceList();
@@ -1578,12 +1579,16 @@ static void macosx_hidutilities_quit(void)
     devices = NULL;
     logical_mice = 0;
     physical_mice = 0;
+    manymouse_macosx_hid_in_use = 0;
 } /* macosx_hidutilities_quit */
 
 
-static int macosx_hidutilities_init(void)
+static int macosx_hidutilities_init(void **instance, unsigned int flags)
 {
-    macosx_hidutilities_quit();  /* just in case... */
+    if (manymouse_macosx_hid_in_use)
+        return -1;  /* everything's static; there can only be one. */
+
+    macosx_hidutilities_quit(NULL);  /* just in case... */
 
     if (!HIDBuildDeviceList(kHIDPage_GenericDesktop, kHIDUsage_GD_Mouse))
         return -1;
@@ -1599,7 +1604,7 @@ static int macosx_hidutilities_init(void)
         devices = (pRecDevice *) malloc(sizeof (pRecDevice) * physical_mice);
         if ((devices == NULL) || (dev == NULL))
         {
-            macosx_hidutilities_quit();
+            macosx_hidutilities_quit(NULL);
             return -1;
         } /* if */
 
@@ -1631,6 +1636,8 @@ static int macosx_hidutilities_init(void)
         } /* for */
     } /* if */
 
+    *instance = NULL;
+    manymouse_macosx_hid_in_use = 1;
     return logical_mice;
 } /* macosx_hidutilities_init */
 
@@ -1652,14 +1659,14 @@ static pRecDevice map_logical_device(const unsigned int index)
 } /* map_logical_device */
 
 
-static const char *macosx_hidutilities_name(unsigned int index)
+static const char *macosx_hidutilities_name(void *instance, unsigned int index)
 {
     pRecDevice dev = map_logical_device(index);
     return (dev != NULL) ? dev->product : NULL;
 } /* macosx_hidutilities_name */
 
 
-static int macosx_hidutilities_poll(ManyMouseEvent *event)
+static int macosx_hidutilities_poll(void *instance, ManyMouseEvent *event)
 {
     /*
      * (i) is static so we iterate through all mice round-robin. This
@@ -1715,7 +1722,12 @@ static const ManyMouseDriver ManyMouseDriver_interface =
     macosx_hidutilities_init,
     macosx_hidutilities_quit,
     macosx_hidutilities_name,
-    macosx_hidutilities_poll
+    macosx_hidutilities_poll,
+    NULL,  /* no native batch polling. */
+    NULL,  /* no native waiting. */
+    NULL,  /* no readiness fd. */
+    NULL,  /* no stats. */
+    NULL   /* no device info. */
 };
 
 const ManyMouseDriver *ManyMouseDriver_hidutilities = &ManyMouseDriver_interface;
@@ -7,9 +7,26 @@
  *  This file written by Ryan C. Gordon.
  */
 
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include "manymouse.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+/* Windows and Mac OS X drivers tie their mice to the thread that found them. */
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define PROBE_THREAD 1
+#include <pthread.h>
+#endif
+
 static const char *manymouse_copyright =
     "ManyMouse " MANYMOUSE_VERSION " copyright (c) 2005-2012 Ryan C. Gordon.";
 
@@ -28,73 +45,1374 @@ extern const ManyMouseDriver *ManyMouseDriver_xinput2;
  *  and later). In the Mac OS X case, you want to try the newer tech, and if
  *  it's not available (on 10.4 or earlier), fall back to trying the legacy
  *  code.
+ *
+ * The short names are what ManyMouse_InitDriver() and the MANYMOUSE_DRIVER
+ *  environment variable take. Don't change them; apps depend on them.
  */
-static const ManyMouseDriver **mice_drivers[] =
+static const struct
 {
-    &ManyMouseDriver_xinput2,
-    &ManyMouseDriver_evdev,
-    &ManyMouseDriver_windows,
-    &ManyMouseDriver_hidmanager,
-    &ManyMouseDriver_hidutilities,
+    const char *name;
+    const ManyMouseDriver **driver;
+} mice_drivers[] =
+{
+    { "xinput2", &ManyMouseDriver_xinput2 },
+    { "evdev", &ManyMouseDriver_evdev },
+    { "windows", &ManyMouseDriver_windows },
+    { "hidmanager", &ManyMouseDriver_hidmanager },
+    { "hidutilities", &ManyMouseDriver_hidutilities },
 };
 
 
-static const ManyMouseDriver *driver = NULL;
+/* Coalescing mode pulls up to this many events from the driver at once. */
+#define STAGE_SIZE 256
 
-int ManyMouse_Init(void)
+/* Device state comes in blocks of this many devices; see device_slot(). */
+#define DEVICE_STATE_BLOCK 64
+
+#if defined(_MSC_VER)
+#define STATE_FENCE() MemoryBarrier()
+#else
+#define STATE_FENCE() __sync_synchronize()
+#endif
+
+typedef struct
+{
+    volatile unsigned int seq;
+    ManyMouseDeviceState state;
+    int scroll_rem[2];  /* hi-res wheel motion short of a whole click. */
+    int legacy_scroll_rem[2];  /* same, for apps too old to get it. */
+    ManyMouseDeviceState last_read;  /* reader's thread only. */
+} DeviceStateSlot;
+
+/*
+ * Blocks of slots never move once they're made, since another thread may
+ *  be reading one. When a device past the end shows up, a bigger table
+ *  takes over, pointing at the same blocks plus new ones. The one it
+ *  replaced is kept until quit, in case a reader is still looking at it.
+ */
+typedef struct DeviceStateTable
+{
+    unsigned int block_count;
+    DeviceStateSlot **blocks;
+    struct DeviceStateTable *replaced;
+} DeviceStateTable;
+
+typedef struct
+{
+    unsigned long long key;
+    int index;
+} DeviceKey;
+
+/*
+ * Everything a context has. ManyMouse_Init() and the other functions that
+ *  don't take a context use default_context.
+ */
+struct ManyMouseContext
+{
+    const ManyMouseDriver *driver;
+    void *instance;  /* whatever (driver) keeps for this context. */
+    int coalesce_motion;
+
+    /*
+     * Coalescing mode pulls everything the driver has into here, merging
+     *  motion as it goes, and hands events out from here until it's empty.
+     */
+    ManyMouseEventEx staged[STAGE_SIZE];
+    unsigned int staged_pos;
+    unsigned int staged_count;
+
+    /*
+     * Apps that poll with ManyMouseEvent (or a ManyMouseEventEx older than
+     *  version 2) don't know about 2D motion, so they get one event per
+     *  axis instead. If only the first half fits, the second waits here.
+     */
+    ManyMouseEventEx split_held;
+    int split_pending;
+
+    /*
+     * Every event that comes through here also updates its device's
+     *  state. Each device is a seqlock: the polling thread makes (seq) odd
+     *  while it changes things, and readers on other threads retry until
+     *  they copy the state with (seq) even and unchanged. Deltas are kept
+     *  here as running totals that wrap; readers subtract what they saw
+     *  last time. NULL until some device has state.
+     */
+    DeviceStateTable *volatile device_states;
+    volatile unsigned int device_states_seen;  /* highest index we had, + 1. */
+
+    /*
+     * ManyMouse_FindDevice() looks keys up here: an open-addressed hash
+     *  table, kept at most half full, of every device key we've seen and
+     *  the index it has now (-1 while it's unplugged). Keys are never
+     *  removed, so a device that comes back gets its entry back. A key of
+     *  zero is empty.
+     */
+    DeviceKey *device_keys;
+    unsigned int device_keys_capacity;  /* a power of two. */
+    unsigned int device_keys_used;
+
+    /*
+     * MANYMOUSE_INIT_ASYNC probes drivers on probe_thread, so the app
+     *  isn't stuck waiting on X or a slow /dev/input. Only that thread
+     *  touches the drivers until the app's thread joins it and takes over
+     *  what it found. Then the mice are announced with CONNECT events, and
+     *  device indexes from announce_next to announce_end stay hidden until
+     *  they are.
+     */
+    #ifdef PROBE_THREAD
+    pthread_t probe_thread;
+    #endif
+    int probing;
+    volatile int probe_done;
+    char probe_name[32];
+    unsigned int probe_flags;
+    const ManyMouseDriver *probe_driver;
+    void *probe_instance;
+    int probe_mice;
+    unsigned int announce_next;
+    unsigned int announce_end;
+};
+
+static ManyMouseContext default_context;
+
+static void remember_device(ManyMouseContext *ctx, const unsigned int index);
+
+
+/* Polling thread only: the state for device (index), making room for it. */
+static DeviceStateSlot *device_slot(ManyMouseContext *ctx,
+                                    const unsigned int index)
+{
+    DeviceStateTable *table = ctx->device_states;
+    const unsigned int needed = (index / DEVICE_STATE_BLOCK) + 1;
+    const unsigned int have = (table != NULL) ? table->block_count : 0;
+    DeviceStateTable *grown;
+    unsigned int count;
+    unsigned int i;
+
+    if (needed > have)
+    {
+        for (count = (have > 0) ? have : 1; count < needed; count *= 2)
+            { /* spin. */ }
+
+        grown = (DeviceStateTable *) malloc(sizeof (*grown));
+        if (grown == NULL)
+            return NULL;
+
+        grown->blocks = (DeviceStateSlot **) calloc(count, sizeof (DeviceStateSlot *));
+        if (grown->blocks == NULL)
+        {
+            free(grown);
+            return NULL;
+        } /* if */
+
+        for (i = 0; i < have; i++)
+            grown->blocks[i] = table->blocks[i];
+
+        for (i = have; i < count; i++)
+        {
+            grown->blocks[i] = (DeviceStateSlot *) calloc(DEVICE_STATE_BLOCK, sizeof (DeviceStateSlot));
+            if (grown->blocks[i] == NULL)
+            {
+                while (i-- > have)
+                    free(grown->blocks[i]);
+                free(grown->blocks);
+                free(grown);
+                return NULL;
+            } /* if */
+        } /* for */
+
+        grown->block_count = count;
+        grown->replaced = table;
+        STATE_FENCE();  /* readers see all of it, or the old table. */
+        ctx->device_states = table = grown;
+    } /* if */
+
+    if (index >= ctx->device_states_seen)
+    {
+        STATE_FENCE();  /* readers that see this see the table, too. */
+        ctx->device_states_seen = index + 1;
+    } /* if */
+
+    return &table->blocks[index / DEVICE_STATE_BLOCK][index % DEVICE_STATE_BLOCK];
+} /* device_slot */
+
+/* Any thread: the state for device (index), or NULL if we haven't had it. */
+static DeviceStateSlot *find_device_slot(const ManyMouseContext *ctx,
+                                         const unsigned int index)
+{
+    const DeviceStateTable *table;
+    const unsigned int block = index / DEVICE_STATE_BLOCK;
+
+    if (index >= ctx->device_states_seen)
+        return NULL;  /* blocks have room past the devices we know about. */
+
+    STATE_FENCE();
+    table = ctx->device_states;
+    STATE_FENCE();
+    if ((table == NULL) || (block >= table->block_count))
+        return NULL;
+    return &table->blocks[block][index % DEVICE_STATE_BLOCK];
+} /* find_device_slot */
+
+static void free_device_states(ManyMouseContext *ctx)
+{
+    DeviceStateTable *table = ctx->device_states;
+    unsigned int i;
+
+    if (table != NULL)
+    {
+        /* the newest table has every block. */
+        for (i = 0; i < table->block_count; i++)
+            free(table->blocks[i]);
+    } /* if */
+
+    while (table != NULL)
+    {
+        DeviceStateTable *next = table->replaced;
+        free(table->blocks);
+        free(table);
+        table = next;
+    } /* while */
+
+    ctx->device_states = NULL;
+    ctx->device_states_seen = 0;
+} /* free_device_states */
+
+
+/* Try every driver in order, or just the one called (name) if not NULL. */
+static const ManyMouseDriver *probe_drivers(const char *name,
+                                            const unsigned int flags,
+                                            void **instance, int *mice)
 {
     const int upper = (sizeof (mice_drivers) / sizeof (mice_drivers[0]));
+    const ManyMouseDriver *retval = NULL;
+    int i;
+
+    *mice = -1;
+    for (i = 0; (i < upper) && (retval == NULL); i++)
+    {
+        const ManyMouseDriver *this_driver = *(mice_drivers[i].driver);
+        if ((name != NULL) && (strcmp(name, mice_drivers[i].name) != 0))
+            continue;  /* not the one they asked for; don't even probe it. */
+        else if (this_driver != NULL) /* if not built for this platform, skip it. */
+        {
+            const int found = this_driver->init(instance, flags);
+            if (found > *mice)
+                *mice = found; /* may move from "error" to "no mice found". */
+
+            if (found >= 0)
+                retval = this_driver;
+        } /* if */
+    } /* for */
+
+    return retval;
+} /* probe_drivers */
+
+/* Make (found) the driver. If (announce), its mice come as CONNECT events. */
+static void start_driver(ManyMouseContext *ctx, const ManyMouseDriver *found,
+                         void *instance, const int mice,
+                         const unsigned int flags, const int announce)
+{
     int i;
-    int retval = -1;
+
+    ctx->driver = found;
+    ctx->instance = instance;
+    if (ctx->driver != NULL)
+        ctx->coalesce_motion = ((flags & MANYMOUSE_INIT_COALESCE_MOTION) != 0);
+
+    free_device_states(ctx);
+
+    ctx->announce_next = ctx->announce_end = 0;
+    if ((announce) && (mice > 0))
+    {
+        ctx->announce_end = (unsigned int) mice;
+        return;  /* the CONNECT events do the rest. */
+    } /* if */
+
+    for (i = 0; i < mice; i++)
+    {
+        DeviceStateSlot *slot = device_slot(ctx, (unsigned int) i);
+        if (slot != NULL)
+            slot->state.connected = 1;
+    } /* for */
+
+    for (i = 0; (ctx->driver != NULL) && (i < mice); i++)
+        remember_device(ctx, (unsigned int) i);
+} /* start_driver */
+
+#ifdef PROBE_THREAD
+static void *probe_thread_main(void *_ctx)
+{
+    ManyMouseContext *ctx = (ManyMouseContext *) _ctx;
+    const char *name = (ctx->probe_name[0]) ? ctx->probe_name : NULL;
+    ctx->probe_driver = probe_drivers(name, ctx->probe_flags,
+                                      &ctx->probe_instance, &ctx->probe_mice);
+    STATE_FENCE();
+    ctx->probe_done = 1;
+    return NULL;
+} /* probe_thread_main */
+#endif
+
+/*
+ * Take over from an async probe, if there is one. Unless (block), this
+ *  only happens if the probe is already done. Returns zero if it isn't.
+ */
+static int finish_probe(ManyMouseContext *ctx, const int block)
+{
+    if (!ctx->probing)
+        return 1;
+    else if ((!block) && (!ctx->probe_done))
+        return 0;
+
+#ifdef PROBE_THREAD
+    pthread_join(ctx->probe_thread, NULL);
+#endif
+    ctx->probing = 0;
+    start_driver(ctx, ctx->probe_driver, ctx->probe_instance, ctx->probe_mice,
+                 ctx->probe_flags, 1);
+    return 1;
+} /* finish_probe */
+
+static int init_context(ManyMouseContext *ctx, const char *name,
+                        unsigned int flags)
+{
+    const ManyMouseDriver *found;
+    void *instance = NULL;
+    int mice;
 
     /* impossible test to keep manymouse_copyright linked into the binary. */
     if (manymouse_copyright == NULL)
         return -1;
 
-    if (driver != NULL)
+    if ((ctx->driver != NULL) || (ctx->probing))
         return -1;
 
-    for (i = 0; (i < upper) && (driver == NULL); i++)
+    if ((flags & MANYMOUSE_INIT_ASYNC) == 0)
     {
-        const ManyMouseDriver *this_driver = *(mice_drivers[i]);
-        if (this_driver != NULL) /* if not built for this platform, skip it. */
-        {
-            const int mice = this_driver->init();
-            if (mice > retval)
-                retval = mice; /* may move from "error" to "no mice found". */
+        found = probe_drivers(name, flags, &instance, &mice);
+        start_driver(ctx, found, instance, mice, flags, 0);
+        return mice;
+    } /* if */
 
-            if (mice >= 0)
-                driver = this_driver;
-        } /* if */
-    } /* for */
+    flags &= ~MANYMOUSE_INIT_ASYNC;
+    if ((name != NULL) && (strlen(name) >= sizeof (ctx->probe_name)))
+        return -1;  /* can't be one of ours. */
 
-    return retval;
+#ifdef PROBE_THREAD
+    strcpy(ctx->probe_name, (name != NULL) ? name : "");
+    ctx->probe_flags = flags;
+    ctx->probe_driver = NULL;
+    ctx->probe_instance = NULL;
+    ctx->probe_mice = -1;
+    ctx->probe_done = 0;
+    STATE_FENCE();
+    if (pthread_create(&ctx->probe_thread, NULL, probe_thread_main, ctx) == 0)
+    {
+        ctx->probing = 1;
+        return 0;  /* the system works, but no mice (yet). */
+    } /* if */
+#endif
+
+    /* no thread; probe right here, but still announce them like we promised. */
+    found = probe_drivers(name, flags, &instance, &mice);
+    start_driver(ctx, found, instance, mice, flags, 1);
+    return (mice < 0) ? -1 : 0;
+} /* init_context */
+
+static void quit_context(ManyMouseContext *ctx)
+{
+    finish_probe(ctx, 1);  /* can't stop it, so wait it out and shut it down. */
+
+    if (ctx->driver != NULL)
+    {
+        ctx->driver->quit(ctx->instance);
+        ctx->driver = NULL;
+        ctx->instance = NULL;
+    } /* if */
+
+    ctx->coalesce_motion = 0;
+    ctx->staged_pos = ctx->staged_count = 0;
+    ctx->split_pending = 0;
+    ctx->announce_next = ctx->announce_end = 0;
+
+    free(ctx->device_keys);
+    ctx->device_keys = NULL;
+    ctx->device_keys_capacity = ctx->device_keys_used = 0;
+
+    free_device_states(ctx);
+} /* quit_context */
+
+/* lets you skip probing drivers you know won't work, like X on a server. */
+static const char *env_driver_name(void)
+{
+    const char *env = getenv("MANYMOUSE_DRIVER");
+    return ((env != NULL) && (*env)) ? env : NULL;
+} /* env_driver_name */
+
+
+int ManyMouse_Init(void)
+{
+    return ManyMouse_InitEx(0);
 } /* ManyMouse_Init */
 
 
+int ManyMouse_InitEx(unsigned int flags)
+{
+    return init_context(&default_context, env_driver_name(), flags);
+} /* ManyMouse_InitEx */
+
+
+int ManyMouse_InitDriver(const char *name, unsigned int flags)
+{
+    if (name == NULL)
+        return -1;
+    return init_context(&default_context, name, flags);
+} /* ManyMouse_InitDriver */
+
+
+const char *ManyMouse_ListDrivers(unsigned int index)
+{
+    const unsigned int upper = (sizeof (mice_drivers) / sizeof (mice_drivers[0]));
+    unsigned int i;
+
+    /* only the ones built for this platform. */
+    for (i = 0; i < upper; i++)
+    {
+        if ((*(mice_drivers[i].driver) != NULL) && (index-- == 0))
+            return mice_drivers[i].name;
+    } /* for */
+
+    return NULL;
+} /* ManyMouse_ListDrivers */
+
+
 void ManyMouse_Quit(void)
 {
-    if (driver != NULL)
+    quit_context(&default_context);
+} /* ManyMouse_Quit */
+
+
+ManyMouseContext *ManyMouse_CreateContext(const char *driver,
+                                          unsigned int flags, int *mice)
+{
+    ManyMouseContext *ctx = (ManyMouseContext *) calloc(1, sizeof (*ctx));
+    int rc = -1;
+
+    if (ctx != NULL)
     {
-        driver->quit();
-        driver = NULL;
+        rc = init_context(ctx, (driver != NULL) ? driver : env_driver_name(), flags);
+        if (rc < 0)
+        {
+            free(ctx);
+            ctx = NULL;
+        } /* if */
     } /* if */
-} /* ManyMouse_Quit */
+
+    if (mice != NULL)
+        *mice = rc;
+    return ctx;
+} /* ManyMouse_CreateContext */
+
+
+void ManyMouse_DestroyContext(ManyMouseContext *ctx)
+{
+    if (ctx != NULL)
+    {
+        quit_context(ctx);
+        free(ctx);
+    } /* if */
+} /* ManyMouse_DestroyContext */
+
+
+const char *ManyMouse_ContextDriverName(ManyMouseContext *ctx)
+{
+    finish_probe(ctx, 0);
+    return (ctx->driver) ? ctx->driver->driver_name : NULL;
+} /* ManyMouse_ContextDriverName */
+
+/* Nonzero unless (index) is a mouse an async init found but hasn't announced. */
+static int announced(const ManyMouseContext *ctx, const unsigned int index)
+{
+    return ((index < ctx->announce_next) || (index >= ctx->announce_end));
+} /* announced */
+
+const char *ManyMouse_ContextDeviceName(ManyMouseContext *ctx, unsigned int index)
+{
+    if ((ctx->driver == NULL) || (!announced(ctx, index)))
+        return NULL;
+    return ctx->driver->name(ctx->instance, index);
+} /* ManyMouse_ContextDeviceName */
+
+/* Events are pulled from the driver this many at a time for conversion. */
+#define POLL_CHUNK 32
+
+/*
+ * ManyMouseEventEx as older versions of manymouse.h had it. Apps built
+ *  against those step through their arrays by the old sizeof, which
+ *  includes tail padding, so the offset of the next version's first field
+ *  isn't good enough. Never change these; add one when the version goes up.
+ */
+typedef struct
+{
+    unsigned int version;
+    ManyMouseEventType type;
+    unsigned int device;
+    unsigned int item;
+    int value;
+    int minval;
+    int maxval;
+    unsigned long long timestamp;
+} ManyMouseEventExV1;
+
+typedef struct
+{
+    unsigned int version;
+    ManyMouseEventType type;
+    unsigned int device;
+    unsigned int item;
+    int value;
+    int minval;
+    int maxval;
+    unsigned long long timestamp;
+    int value2;
+    int minval2;
+    int maxval2;
+} ManyMouseEventExV2;
+
+typedef struct
+{
+    unsigned int version;
+    ManyMouseEventType type;
+    unsigned int device;
+    unsigned int item;
+    int value;
+    int minval;
+    int maxval;
+    unsigned long long timestamp;
+    int value2;
+    int minval2;
+    int maxval2;
+    int divisor;
+} ManyMouseEventExV3;
+
+/* sizeof ManyMouseEventEx in an app built for (version). */
+static size_t eventex_size(const unsigned int version)
+{
+    if (version == 0)
+        return 0;  /* not a valid version. */
+    else if (version == 1)
+        return sizeof (ManyMouseEventExV1);
+    else if (version == 2)
+        return sizeof (ManyMouseEventExV2);
+    else if (version == 3)
+        return sizeof (ManyMouseEventExV3);
+    return sizeof (ManyMouseEventEx);
+} /* eventex_size */
+
+static void eventex_to_event(const ManyMouseEventEx *ex, ManyMouseEvent *ev)
+{
+    ev->type = ex->type;
+    ev->device = ex->device;
+    ev->item = ex->item;
+    ev->value = ex->value;
+    ev->minval = ex->minval;
+    ev->maxval = ex->maxval;
+} /* eventex_to_event */
+
+static void event_to_eventex(const ManyMouseEvent *ev, ManyMouseEventEx *ex)
+{
+    memset(ex, '\0', sizeof (*ex));
+    ex->version = MANYMOUSE_EVENTEX_VERSION;
+    ex->type = ev->type;
+    ex->device = ev->device;
+    ex->item = ev->item;
+    ex->value = ev->value;
+    ex->minval = ev->minval;
+    ex->maxval = ev->maxval;
+    if (ev->type == MANYMOUSE_EVENT_SCROLL)
+        ex->divisor = 1;  /* the old interface only has whole clicks. */
+} /* event_to_eventex */
+
+/* Get up to (max) events from the driver, however it prefers to supply them. */
+static unsigned int poll_driver_raw(ManyMouseContext *ctx,
+                                    ManyMouseEventEx *events,
+                                    unsigned int max)
+{
+    ManyMouseEvent event;
+    unsigned int i = 0;
+
+    if (ctx->driver->poll_batch != NULL)
+        return (unsigned int) ctx->driver->poll_batch(ctx->instance, events, max);
+
+    /* driver can't do batches itself, so just loop over single polls. */
+    while ((i < max) && (ctx->driver->poll(ctx->instance, &event)))
+        event_to_eventex(&event, &events[i++]);
+
+    return i;
+} /* poll_driver_raw */
+
+/*
+ * Add (event) to staged[], or fold it into an earlier RELMOTION for the
+ *  same device and axis (or RELMOTION2D for the same device), if nothing
+ *  else from that device came between.
+ */
+static void stage_event(ManyMouseContext *ctx, const ManyMouseEventEx *event)
+{
+    unsigned int i = ctx->staged_count;
+
+    if ((event->type == MANYMOUSE_EVENT_RELMOTION) ||
+        (event->type == MANYMOUSE_EVENT_RELMOTION2D))
+    {
+        while (i-- > 0)
+        {
+            ManyMouseEventEx *prev = &ctx->staged[i];
+            if (prev->device != event->device)
+                continue;
+            else if (prev->type != event->type)
+                break;  /* something else happened; run is over. */
+            else if (event->type == MANYMOUSE_EVENT_RELMOTION2D)
+            {
+                prev->item |= event->item;
+                prev->value += event->value;
+                prev->value2 += event->value2;
+                prev->timestamp = event->timestamp;
+                return;
+            } /* else if */
+            else if (prev->item == event->item)
+            {
+                prev->value += event->value;
+                prev->timestamp = event->timestamp;
+                return;
+            } /* else if */
+        } /* while */
+    } /* if */
+
+    memcpy(&ctx->staged[ctx->staged_count++], event, sizeof (*event));
+} /* stage_event */
+
+/* Get up to (max) events, coalescing motion if the app asked for that. */
+static unsigned int fetch_events(ManyMouseContext *ctx,
+                                 ManyMouseEventEx *events, unsigned int max)
+{
+    unsigned int count;
+
+    if (!ctx->coalesce_motion)
+        return poll_driver_raw(ctx, events, max);
+
+    if (ctx->staged_pos == ctx->staged_count)  /* empty? Drain the driver again. */
+    {
+        ManyMouseEventEx buf[POLL_CHUNK];
+        unsigned int want;
+        unsigned int got;
+
+        ctx->staged_pos = ctx->staged_count = 0;
+        do
+        {
+            const unsigned int room = STAGE_SIZE - ctx->staged_count;
+            unsigned int i;
+            want = (room < POLL_CHUNK) ? room : POLL_CHUNK;
+            got = poll_driver_raw(ctx, buf, want);
+            for (i = 0; i < got; i++)
+                stage_event(ctx, &buf[i]);
+        } while ((got == want) && (ctx->staged_count < STAGE_SIZE));
+    } /* if */
+
+    count = ctx->staged_count - ctx->staged_pos;
+    if (count > max)
+        count = max;
+    memcpy(events, &ctx->staged[ctx->staged_pos], count * sizeof (*events));
+    ctx->staged_pos += count;
+    return count;
+} /* fetch_events */
+
+/* Add a SCROLL event to (*rem), and take out the whole clicks in it. */
+static int whole_clicks(int *rem, const ManyMouseEventEx *event)
+{
+    int clicks;
+
+    if (event->divisor <= 1)
+        return event->value;  /* it's already whole clicks. */
+
+    *rem += event->value;
+    clicks = *rem / event->divisor;  /* rounds toward zero, either way. */
+    *rem -= clicks * event->divisor;
+    return clicks;
+} /* whole_clicks */
+
+static void update_state(ManyMouseContext *ctx, const ManyMouseEventEx *event)
+{
+    DeviceStateSlot *slot;
+    ManyMouseDeviceState *state;
+
+    slot = device_slot(ctx, event->device);
+    if (slot == NULL)
+        return;  /* out of memory; the state just stays stale. */
+
+    state = &slot->state;
+    slot->seq++;
+    STATE_FENCE();
+
+    switch (event->type)
+    {
+        case MANYMOUSE_EVENT_RELMOTION:
+            if (event->item == 0)
+                state->dx = (int) ((unsigned int) state->dx + event->value);
+            else if (event->item == 1)
+                state->dy = (int) ((unsigned int) state->dy + event->value);
+            break;
+
+        case MANYMOUSE_EVENT_ABSMOTION:
+            if (event->item == 0)
+            {
+                state->x = event->value;
+                state->minx = event->minval;
+                state->maxx = event->maxval;
+            } /* if */
+            else if (event->item == 1)
+            {
+                state->y = event->value;
+                state->miny = event->minval;
+                state->maxy = event->maxval;
+            } /* else if */
+            break;
+
+        case MANYMOUSE_EVENT_RELMOTION2D:
+            if (event->item & 1)
+                state->dx = (int) ((unsigned int) state->dx + event->value);
+            if (event->item & 2)
+                state->dy = (int) ((unsigned int) state->dy + event->value2);
+            break;
+
+        case MANYMOUSE_EVENT_ABSMOTION2D:
+            if (event->item & 1)
+            {
+                state->x = event->value;
+                state->minx = event->minval;
+                state->maxx = event->maxval;
+            } /* if */
+            if (event->item & 2)
+            {
+                state->y = event->value2;
+                state->miny = event->minval2;
+                state->maxy = event->maxval2;
+            } /* if */
+            break;
+
+        case MANYMOUSE_EVENT_BUTTON:
+            if (event->item < 32)
+            {
+                if (event->value)
+                    state->buttons |= (1u << event->item);
+                else
+                    state->buttons &= ~(1u << event->item);
+            } /* if */
+            break;
+
+        case MANYMOUSE_EVENT_SCROLL:
+            if (event->item == 0)
+            {
+                const int clicks = whole_clicks(&slot->scroll_rem[0], event);
+                state->scroll_y = (int) ((unsigned int) state->scroll_y + clicks);
+            } /* if */
+            else if (event->item == 1)
+            {
+                const int clicks = whole_clicks(&slot->scroll_rem[1], event);
+                state->scroll_x = (int) ((unsigned int) state->scroll_x + clicks);
+            } /* else if */
+            break;
+
+        case MANYMOUSE_EVENT_DISCONNECT:
+            state->connected = 0;
+            state->buttons = 0;
+            break;
+
+        case MANYMOUSE_EVENT_CONNECT:  /* indexes are never reused; start fresh. */
+            memset(state, '\0', sizeof (*state));
+            state->connected = 1;
+            slot->scroll_rem[0] = slot->scroll_rem[1] = 0;
+            slot->legacy_scroll_rem[0] = slot->legacy_scroll_rem[1] = 0;
+            break;
+
+        default: break;
+    } /* switch */
+
+    STATE_FENCE();
+    slot->seq++;
+} /* update_state */
+
+/*
+ * FNV-1a. Device keys have to come out the same every run, so this can't
+ *  be anything seeded or randomized.
+ */
+static unsigned long long fnv1a(unsigned long long hash, const void *data,
+                                size_t len)
+{
+    const unsigned char *ptr = (const unsigned char *) data;
+    while (len--)
+    {
+        hash ^= *(ptr++);
+        hash *= 0x100000001B3ull;
+    } /* while */
+    return hash;
+} /* fnv1a */
+
+/*
+ * A device's key is what it is (bus, vendor, product) plus what tells it
+ *  apart from others like it: its serial number if it has one, which
+ *  follows it to any port, or else the port it's plugged into, or else
+ *  just its name. The firmware version is left out on purpose.
+ */
+static unsigned long long device_key(const ManyMouseDeviceInfo *info,
+                                     const char *name)
+{
+    const unsigned int ids[3] = { info->bustype, info->vendor, info->product };
+    unsigned long long hash = 0xCBF29CE484222325ull;
+    const char *what = "n";
+
+    if (info->uniq[0])
+    {
+        what = "u";
+        name = info->uniq;
+    } /* if */
+    else if (info->phys[0])
+    {
+        what = "p";
+        name = info->phys;
+    } /* else if */
+
+    hash = fnv1a(hash, ids, sizeof (ids));
+    hash = fnv1a(hash, what, 1);  /* so a serial and a port can't collide. */
+    hash = fnv1a(hash, name, strlen(name));
+    return (hash == 0) ? 1 : hash;  /* zero means an empty slot. */
+} /* device_key */
+
+/* Where (key) is in device_keys[], or the empty slot where it would go. */
+static DeviceKey *find_device_key(ManyMouseContext *ctx,
+                                  const unsigned long long key)
+{
+    const unsigned int mask = ctx->device_keys_capacity - 1;
+    unsigned int i = (unsigned int) (key ^ (key >> 32)) & mask;
+    while ((ctx->device_keys[i].key != 0) && (ctx->device_keys[i].key != key))
+        i = (i + 1) & mask;
+    return &ctx->device_keys[i];
+} /* find_device_key */
+
+static int grow_device_keys(ManyMouseContext *ctx)
+{
+    const unsigned int oldcap = ctx->device_keys_capacity;
+    const unsigned int newcap = oldcap ? (oldcap * 2) : 64;
+    DeviceKey *oldkeys = ctx->device_keys;
+    DeviceKey *newkeys;
+    unsigned int i;
+
+    newkeys = (DeviceKey *) calloc(newcap, sizeof (DeviceKey));
+    if (newkeys == NULL)
+        return 0;
+
+    ctx->device_keys = newkeys;
+    ctx->device_keys_capacity = newcap;
+    for (i = 0; i < oldcap; i++)
+    {
+        if (oldkeys[i].key != 0)
+            memcpy(find_device_key(ctx, oldkeys[i].key), &oldkeys[i], sizeof (DeviceKey));
+    } /* for */
+
+    free(oldkeys);
+    return 1;
+} /* grow_device_keys */
+
+/* Point (index)'s key at it, for ManyMouse_FindDevice(). */
+static void remember_device(ManyMouseContext *ctx, const unsigned int index)
+{
+    ManyMouseDeviceInfo info;
+    DeviceKey *slot;
+
+    if (!ManyMouse_ContextDeviceInfo(ctx, index, &info))
+        return;
+    else if (((ctx->device_keys_used + 1) * 2 > ctx->device_keys_capacity) && (!grow_device_keys(ctx)))
+        return;  /* out of memory; this one just won't be found. */
+
+    slot = find_device_key(ctx, info.key);
+    if (slot->key == 0)
+    {
+        slot->key = info.key;
+        ctx->device_keys_used++;
+    } /* if */
+    slot->index = (int) index;
+} /* remember_device */
+
+/* (index) was unplugged; its key doesn't find anything until it's back. */
+static void forget_device(ManyMouseContext *ctx, const unsigned int index)
+{
+    ManyMouseDeviceInfo info;
+    DeviceKey *slot;
+
+    if ((ctx->device_keys_capacity == 0) || (!ManyMouse_ContextDeviceInfo(ctx, index, &info)))
+        return;
+
+    slot = find_device_key(ctx, info.key);
+    if ((slot->key != 0) && (slot->index == (int) index))
+        slot->index = -1;  /* a newer device with this key might have it now. */
+} /* forget_device */
+
+/* CONNECT events for what an async init found; they go before anything else. */
+static unsigned int announce_devices(ManyMouseContext *ctx,
+                                     ManyMouseEventEx *events,
+                                     const unsigned int max)
+{
+    unsigned int i = 0;
+    while ((i < max) && (ctx->announce_next < ctx->announce_end))
+    {
+        ManyMouseEventEx *event = &events[i++];
+        memset(event, '\0', sizeof (*event));
+        event->version = MANYMOUSE_EVENTEX_VERSION;
+        event->type = MANYMOUSE_EVENT_CONNECT;
+        event->device = ctx->announce_next++;
+    } /* while */
+    return i;
+} /* announce_devices */
+
+/* Everything the app gets comes through here, so the state sees it all. */
+static unsigned int poll_driver(ManyMouseContext *ctx,
+                                ManyMouseEventEx *events, unsigned int max)
+{
+    unsigned int count = announce_devices(ctx, events, max);
+    unsigned int i;
+
+    if (count < max)
+        count += fetch_events(ctx, events + count, max - count);
+    for (i = 0; i < count; i++)
+    {
+        const ManyMouseEventEx *event = &events[i];
+        update_state(ctx, event);
+        if (event->type == MANYMOUSE_EVENT_CONNECT)
+            remember_device(ctx, event->device);
+        else if (event->type == MANYMOUSE_EVENT_DISCONNECT)
+            forget_device(ctx, event->device);
+    } /* for */
+    return count;
+} /* poll_driver */
+
+/* Make the 1D event for (axis) of a 2D motion event. */
+static void split_axis(const ManyMouseEventEx *event, const unsigned int axis,
+                       ManyMouseEventEx *out)
+{
+    memcpy(out, event, sizeof (*out));
+    if (event->type == MANYMOUSE_EVENT_RELMOTION2D)
+        out->type = MANYMOUSE_EVENT_RELMOTION;
+    else
+        out->type = MANYMOUSE_EVENT_ABSMOTION;
+    out->item = axis;
+    if (axis == 1)
+    {
+        out->value = event->value2;
+        out->minval = event->minval2;
+        out->maxval = event->maxval2;
+    } /* if */
+    out->value2 = out->minval2 = out->maxval2 = 0;
+} /* split_axis */
+
+/*
+ * poll_driver(), but only with what an app built for ManyMouseEventEx
+ *  (version) understands: before version 2, 2D motion is split up, before
+ *  version 3, hi-res SCROLL adds up to whole clicks, and before version 4,
+ *  TOUCH events are dropped. ManyMouseEvent is version 1.
+ */
+static unsigned int poll_events(ManyMouseContext *ctx,
+                                ManyMouseEventEx *events, unsigned int max,
+                                const unsigned int version)
+{
+    ManyMouseEventEx buf[POLL_CHUNK];
+    unsigned int count = 0;
+
+    if ((max > 0) && (ctx->split_pending))  /* left over from last time; goes first. */
+    {
+        memcpy(&events[count++], &ctx->split_held, sizeof (*events));
+        ctx->split_pending = 0;
+    } /* if */
+
+    if (version >= 4)
+        return count + poll_driver(ctx, events + count, max - count);
+
+    while (count < max)
+    {
+        /* each event may become two, so only the last one can not fit. */
+        const unsigned int room = ((max - count) + 1) / 2;
+        const unsigned int want = (room < POLL_CHUNK) ? room : POLL_CHUNK;
+        const unsigned int got = poll_driver(ctx, buf, want);
+        unsigned int i;
+
+        for (i = 0; i < got; i++)
+        {
+            const ManyMouseEventEx *event = &buf[i];
+            if (event->type == MANYMOUSE_EVENT_TOUCH)
+                continue;  /* these apps see the first finger as ABSMOTION. */
+            else if ((version < 3) && (event->type == MANYMOUSE_EVENT_SCROLL) &&
+                     (event->divisor > 1))
+            {
+                DeviceStateSlot *slot = device_slot(ctx, event->device);
+                int scratch = 0;  /* nowhere to keep the rest; out of memory. */
+                int *rem = &scratch;
+                int clicks;
+                if ((slot != NULL) && (event->item < 2))
+                    rem = &slot->legacy_scroll_rem[event->item];
+                clicks = whole_clicks(rem, event);
+                if (clicks == 0)
+                    continue;  /* not a whole click yet. */
+                memcpy(&events[count], event, sizeof (*event));
+                events[count].value = clicks;
+                events[count++].divisor = 1;
+                continue;
+            } /* else if */
+            else if ((version >= 2) ||
+                     ((event->type != MANYMOUSE_EVENT_RELMOTION2D) &&
+                      (event->type != MANYMOUSE_EVENT_ABSMOTION2D)))
+            {
+                memcpy(&events[count++], event, sizeof (*event));
+                continue;
+            } /* else if */
+
+            if (event->item & 1)
+                split_axis(event, 0, &events[count++]);
+            if ((event->item & 2) && (count < max))
+                split_axis(event, 1, &events[count++]);
+            else if (event->item & 2)
+            {
+                split_axis(event, 1, &ctx->split_held);
+                ctx->split_pending = 1;
+            } /* else if */
+        } /* for */
+
+        if (got < want)
+            break;  /* queue is empty for now. */
+    } /* while */
+
+    return count;
+} /* poll_events */
+
+int ManyMouse_ContextPollEvent(ManyMouseContext *ctx, ManyMouseEvent *event)
+{
+    ManyMouseEventEx ex;
+
+    finish_probe(ctx, 0);
+    if ((ctx->driver == NULL) || (event == NULL))
+        return 0;
+    else if (!poll_events(ctx, &ex, 1, 1))
+        return 0;
+
+    eventex_to_event(&ex, event);
+    return 1;
+} /* ManyMouse_ContextPollEvent */
+
+int ManyMouse_ContextPollEvents(ManyMouseContext *ctx, ManyMouseEvent *events, unsigned int max)
+{
+    ManyMouseEventEx buf[POLL_CHUNK];
+    unsigned int count = 0;
+
+    finish_probe(ctx, 0);
+    if ((ctx->driver == NULL) || (events == NULL))
+        return 0;
+
+    while (count < max)
+    {
+        const unsigned int want = ((max-count) < POLL_CHUNK) ? (max-count) : POLL_CHUNK;
+        const unsigned int got = poll_events(ctx, buf, want, 1);
+        unsigned int i;
+
+        for (i = 0; i < got; i++)
+            eventex_to_event(&buf[i], &events[count++]);
+
+        if (got < want)
+            break;  /* queue is empty for now. */
+    } /* while */
+
+    return (int) count;
+} /* ManyMouse_ContextPollEvents */
+
+int ManyMouse_ContextPollEventEx(ManyMouseContext *ctx, ManyMouseEventEx *event)
+{
+    return ManyMouse_ContextPollEventsEx(ctx, event, 1);
+} /* ManyMouse_ContextPollEventEx */
+
+int ManyMouse_ContextPollEventsEx(ManyMouseContext *ctx, ManyMouseEventEx *events, unsigned int max)
+{
+    ManyMouseEventEx buf[POLL_CHUNK];
+    unsigned int version;
+    unsigned int count = 0;
+    char *dst = (char *) events;
+    size_t stride;
+
+    finish_probe(ctx, 0);
+    if ((ctx->driver == NULL) || (events == NULL))
+        return 0;
+
+    /*
+     * The whole array is assumed to be the version the first element is.
+     *  We write back the version we actually filled in, which is less than
+     *  the app's if it was built against a newer header than we were. We
+     *  can't know the size of elements in that case, so only do one.
+     */
+    version = events->version;
+    if (version > MANYMOUSE_EVENTEX_VERSION)
+    {
+        version = MANYMOUSE_EVENTEX_VERSION;
+        if (max > 1)
+            max = 1;
+    } /* if */
+
+    stride = eventex_size(version);
+    if (stride == 0)
+        return 0;
+
+    /* app knows about everything we do? Skip the extra copy. */
+    if (version == MANYMOUSE_EVENTEX_VERSION)
+        return (int) poll_events(ctx, events, max, version);
+
+    while (count < max)
+    {
+        const unsigned int want = ((max-count) < POLL_CHUNK) ? (max-count) : POLL_CHUNK;
+        const unsigned int got = poll_events(ctx, buf, want, version);
+        unsigned int i;
+
+        for (i = 0; i < got; i++, count++, dst += stride)
+        {
+            buf[i].version = version;
+            memcpy(dst, &buf[i], stride);
+        } /* for */
+
+        if (got < want)
+            break;  /* queue is empty for now. */
+    } /* while */
+
+    return (int) count;
+} /* ManyMouse_ContextPollEventsEx */
+
+/* Milliseconds from an arbitrary starting point. Wraps around, so subtract. */
+static unsigned int ticks_ms(void)
+{
+#if defined(_WIN32)
+    return (unsigned int) GetTickCount();
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (((unsigned int) ts.tv_sec) * 1000) +
+           ((unsigned int) (ts.tv_nsec / 1000000));
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (((unsigned int) tv.tv_sec) * 1000) +
+           ((unsigned int) (tv.tv_usec / 1000));
+#endif
+} /* ticks_ms */
+
+static void delay_ms(const unsigned int ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+} /* delay_ms */
+
+int ManyMouse_ContextWaitEvent(ManyMouseContext *ctx, ManyMouseEvent *event, int timeout_ms)
+{
+    const unsigned int start = ticks_ms();
+    int remaining = timeout_ms;
+
+    finish_probe(ctx, 0);
+    if (((ctx->driver == NULL) && (!ctx->probing)) || (event == NULL))
+        return 0;
+
+    while (!ManyMouse_ContextPollEvent(ctx, event))
+    {
+        int rc = -1;
+
+        if (timeout_ms >= 0)
+        {
+            const unsigned int elapsed = ticks_ms() - start;
+            if (elapsed >= (unsigned int) timeout_ms)
+                return 0;  /* timed out. */
+            remaining = timeout_ms - (int) elapsed;
+        } /* if */
+
+        if (ctx->driver == NULL)
+        {
+            if (!ctx->probing)
+                return 0;  /* async init finished, but found nothing. */
+        } /* if */
+        else if (ctx->driver->wait != NULL)
+            rc = ctx->driver->wait(ctx->instance, remaining);
+
+        if (rc == 0)
+            return 0;  /* driver timed out. */
+        else if (rc < 0)
+        {
+            /* driver can't block on the hardware, so just nap and retry. */
+            delay_ms(1);
+        } /* else if */
+
+        /* else, something woke the driver up. Poll again and see. It might
+           not have been something we report, so we may loop around. */
+    } /* while */
+
+    return 1;
+} /* ManyMouse_ContextWaitEvent */
+
+int ManyMouse_ContextReadinessFD(ManyMouseContext *ctx)
+{
+    finish_probe(ctx, 0);
+    if ((ctx->driver == NULL) || (ctx->driver->readiness_fd == NULL))
+        return -1;
+    return ctx->driver->readiness_fd(ctx->instance);
+} /* ManyMouse_ContextReadinessFD */
+
+void ManyMouse_ContextUpdate(ManyMouseContext *ctx)
+{
+    ManyMouseEventEx buf[POLL_CHUNK];
+
+    finish_probe(ctx, 0);
+    if (ctx->driver == NULL)
+        return;
+
+    /* poll_driver() updates the device state; we just throw events away. */
+    ctx->split_pending = 0;
+    while (poll_driver(ctx, buf, POLL_CHUNK) == POLL_CHUNK)
+        { /* spin. */ }
+} /* ManyMouse_ContextUpdate */
+
+int ManyMouse_ContextGetDeviceState(ManyMouseContext *ctx, unsigned int index, ManyMouseDeviceState *state)
+{
+    DeviceStateSlot *slot;
+    ManyMouseDeviceState *last;
+    ManyMouseDeviceState snap;
+    unsigned int seq;
+
+    if ((state == NULL) || ((slot = find_device_slot(ctx, index)) == NULL))
+        return 0;
+
+    do
+    {
+        seq = slot->seq;
+        STATE_FENCE();
+        memcpy(&snap, &slot->state, sizeof (snap));
+        STATE_FENCE();
+    } while ((seq & 1) || (seq != slot->seq));
+
+    /* turn running totals into "since last time." */
+    last = &slot->last_read;
+    memcpy(state, &snap, sizeof (*state));
+    state->dx = (int) ((unsigned int) snap.dx - (unsigned int) last->dx);
+    state->dy = (int) ((unsigned int) snap.dy - (unsigned int) last->dy);
+    state->scroll_x = (int) ((unsigned int) snap.scroll_x - (unsigned int) last->scroll_x);
+    state->scroll_y = (int) ((unsigned int) snap.scroll_y - (unsigned int) last->scroll_y);
+    memcpy(last, &snap, sizeof (*last));
+    return 1;
+} /* ManyMouse_ContextGetDeviceState */
+
+int ManyMouse_ContextDeviceStats(ManyMouseContext *ctx, unsigned int index, ManyMouseStats *stats)
+{
+    if ((ctx->driver == NULL) || (ctx->driver->stats == NULL) || (stats == NULL))
+        return 0;
+    else if (!announced(ctx, index))
+        return 0;
+    return ctx->driver->stats(ctx->instance, index, stats);
+} /* ManyMouse_ContextDeviceStats */
+
+int ManyMouse_ContextDeviceInfo(ManyMouseContext *ctx, unsigned int index, ManyMouseDeviceInfo *info)
+{
+    const char *name;
+
+    if ((ctx->driver == NULL) || (info == NULL) || (!announced(ctx, index)))
+        return 0;
+    else if ((name = ctx->driver->name(ctx->instance, index)) == NULL)
+        return 0;  /* no such device. */
+
+    memset(info, '\0', sizeof (*info));
+    info->system_id = -1;
+    if ((ctx->driver->info != NULL) && (!ctx->driver->info(ctx->instance, index, info)))
+        return 0;
+
+    info->key = device_key(info, name);
+    return 1;
+} /* ManyMouse_ContextDeviceInfo */
+
+int ManyMouse_ContextFindDevice(ManyMouseContext *ctx, unsigned long long key)
+{
+    const DeviceKey *slot;
+
+    if ((ctx->driver == NULL) || (ctx->device_keys_capacity == 0) || (key == 0))
+        return -1;
+
+    slot = find_device_key(ctx, key);
+    return (slot->key == key) ? slot->index : -1;
+} /* ManyMouse_ContextFindDevice */
+
+/* The original API: everything on default_context. */
 
 const char *ManyMouse_DriverName(void)
 {
-    return (driver) ? driver->driver_name : NULL;
+    return ManyMouse_ContextDriverName(&default_context);
 } /* ManyMouse_DriverName */
 
 const char *ManyMouse_DeviceName(unsigned int index)
 {
-    return (driver) ? driver->name(index) : NULL;
+    return ManyMouse_ContextDeviceName(&default_context, index);
 } /* ManyMouse_DeviceName */
 
 int ManyMouse_PollEvent(ManyMouseEvent *event)
 {
-    return (driver) ? driver->poll(event) : 0;
+    return ManyMouse_ContextPollEvent(&default_context, event);
 } /* ManyMouse_PollEvent */
 
+int ManyMouse_PollEvents(ManyMouseEvent *events, unsigned int max)
+{
+    return ManyMouse_ContextPollEvents(&default_context, events, max);
+} /* ManyMouse_PollEvents */
+
+int ManyMouse_PollEventEx(ManyMouseEventEx *event)
+{
+    return ManyMouse_ContextPollEventEx(&default_context, event);
+} /* ManyMouse_PollEventEx */
+
+int ManyMouse_PollEventsEx(ManyMouseEventEx *events, unsigned int max)
+{
+    return ManyMouse_ContextPollEventsEx(&default_context, events, max);
+} /* ManyMouse_PollEventsEx */
+
+int ManyMouse_WaitEvent(ManyMouseEvent *event, int timeout_ms)
+{
+    return ManyMouse_ContextWaitEvent(&default_context, event, timeout_ms);
+} /* ManyMouse_WaitEvent */
+
+int ManyMouse_ReadinessFD(void)
+{
+    return ManyMouse_ContextReadinessFD(&default_context);
+} /* ManyMouse_ReadinessFD */
+
+void ManyMouse_Update(void)
+{
+    ManyMouse_ContextUpdate(&default_context);
+} /* ManyMouse_Update */
+
+int ManyMouse_GetDeviceState(unsigned int index, ManyMouseDeviceState *state)
+{
+    return ManyMouse_ContextGetDeviceState(&default_context, index, state);
+} /* ManyMouse_GetDeviceState */
+
+int ManyMouse_DeviceStats(unsigned int index, ManyMouseStats *stats)
+{
+    return ManyMouse_ContextDeviceStats(&default_context, index, stats);
+} /* ManyMouse_DeviceStats */
+
+int ManyMouse_DeviceInfo(unsigned int index, ManyMouseDeviceInfo *info)
+{
+    return ManyMouse_ContextDeviceInfo(&default_context, index, info);
+} /* ManyMouse_DeviceInfo */
+
+int ManyMouse_FindDevice(unsigned long long key)
+{
+    return ManyMouse_ContextFindDevice(&default_context, key);
+} /* ManyMouse_FindDevice */
+
 /* end of manymouse.c ... */
 
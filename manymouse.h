@@ -22,9 +22,22 @@ typedef enum
     MANYMOUSE_EVENT_BUTTON,
     MANYMOUSE_EVENT_SCROLL,
     MANYMOUSE_EVENT_DISCONNECT,
+    MANYMOUSE_EVENT_OVERFLOW,  /* samples were merged or lost; see README. */
+    MANYMOUSE_EVENT_CONNECT,  /* a new device; see MANYMOUSE_INIT_HOTPLUG. */
+    MANYMOUSE_EVENT_RELMOTION2D,  /* x and y at once; see MANYMOUSE_INIT_FRAMES. */
+    MANYMOUSE_EVENT_ABSMOTION2D,
+    MANYMOUSE_EVENT_TOUCH,  /* one finger on a multitouch device; see README. */
     MANYMOUSE_EVENT_MAX
 } ManyMouseEventType;
 
+/* The (item) of a MANYMOUSE_EVENT_TOUCH. */
+typedef enum
+{
+    MANYMOUSE_TOUCH_BEGIN = 0,
+    MANYMOUSE_TOUCH_MOVE,
+    MANYMOUSE_TOUCH_END
+} ManyMouseTouchPhase;
+
 typedef struct
 {
     ManyMouseEventType type;
@@ -35,23 +48,163 @@ typedef struct
     int maxval;
 } ManyMouseEvent;
 
+/*
+ * ManyMouseEventEx is ManyMouseEvent plus extra data. Fields are only ever
+ *  added to the end of it, and each addition bumps MANYMOUSE_EVENTEX_VERSION.
+ *  Set (version) before polling with it, so we know how much of the struct
+ *  your app was built to hold; anything newer than that isn't written.
+ */
+#define MANYMOUSE_EVENTEX_VERSION 4
+
+typedef struct
+{
+    unsigned int version;
+    ManyMouseEventType type;
+    unsigned int device;
+    unsigned int item;
+    int value;
+    int minval;
+    int maxval;
+
+    /* version 1 fields... */
+    unsigned long long timestamp;  /* CLOCK_MONOTONIC nanoseconds, 0=unknown */
+
+    /* version 2 fields... */
+    int value2;  /* the y axis of 2D events; (value) is x. */
+    int minval2;
+    int maxval2;
+
+    /* version 3 fields... */
+    int divisor;  /* SCROLL: (value) per wheel click; bigger is finer. */
+
+    /* version 4 fields... */
+    int contact;  /* TOUCH: which finger. Unique while it's down. */
+} ManyMouseEventEx;
+
+
+/*
+ * A device's state, as of the last event ManyMouse processed for it. See
+ *  ManyMouse_GetDeviceState(). The deltas are since the previous call.
+ */
+typedef struct
+{
+    int connected;  /* zero once the device is gone. */
+    int dx;  /* relative motion... */
+    int dy;
+    int scroll_x;  /* ...and wheel clicks, since the last read. */
+    int scroll_y;
+    unsigned int buttons;  /* bit (n) is set while button (n) is down. */
+    int x;  /* last absolute position, if the device reports one... */
+    int y;
+    int minx;  /* ...and its range. All four are zero if it doesn't. */
+    int maxx;
+    int miny;
+    int maxy;
+} ManyMouseDeviceState;
+
+
+/*
+ * Driver counters for a device, for tuning and debugging. See
+ *  ManyMouse_DeviceStats(). Only the evdev driver keeps these, for now.
+ */
+typedef struct
+{
+    unsigned long long reports;  /* complete hardware reports read. */
+    unsigned long long records;  /* raw records read, reports included. */
+    unsigned long long ignored;  /* other records that didn't become events. */
+    unsigned long long drops;  /* times the kernel's buffer overflowed. */
+} ManyMouseStats;
+
+
+/*
+ * What a device is and where it's plugged in, as far as the OS can tell.
+ *  See ManyMouse_DeviceInfo(). Unknown strings are empty, numbers zero.
+ */
+typedef struct
+{
+    unsigned int bustype;  /* BUS_USB, BUS_BLUETOOTH, etc, as linux/input.h has them. */
+    unsigned int vendor;
+    unsigned int product;
+    unsigned int version;
+    int system_id;  /* the XInput2 device id; -1 for other drivers. */
+    char node[64];  /* device node, like "/dev/input/event4". */
+    char phys[128];  /* where it's plugged in, like "usb-0000:00:14.0-2/input0". */
+    char uniq[128];  /* the device's serial number, if it has one. */
+    unsigned long long key;  /* same device, same key; see ManyMouse_FindDevice(). */
+} ManyMouseDeviceInfo;
+
 
-/* internal use only. */
+/*
+ * internal use only. init() sets (*instance) to whatever it needs to find
+ *  its state again; the rest get that back. Drivers that can only run once
+ *  per process fail init() while they're already running.
+ */
 typedef struct
 {
     const char *driver_name;
-    int (*init)(void);
-    void (*quit)(void);
-    const char *(*name)(unsigned int index);
-    int (*poll)(ManyMouseEvent *event);
+    int (*init)(void **instance, unsigned int flags);
+    void (*quit)(void *instance);
+    const char *(*name)(void *instance, unsigned int index);
+    int (*poll)(void *instance, ManyMouseEvent *event);  /* NULL ok if poll_batch isn't. */
+    int (*poll_batch)(void *instance, ManyMouseEventEx *events, unsigned int max);  /* NULL ok */
+    int (*wait)(void *instance, int timeout_ms);  /* NULL ok */
+    int (*readiness_fd)(void *instance);  /* NULL ok */
+    int (*stats)(void *instance, unsigned int index, ManyMouseStats *stats);  /* NULL ok */
+    int (*info)(void *instance, unsigned int index, ManyMouseDeviceInfo *info);  /* NULL ok */
 } ManyMouseDriver;
 
 
+/* Flags for ManyMouse_InitEx(). Drivers that can't do something ignore it. */
+#define MANYMOUSE_INIT_THREADED (1 << 0)  /* read hardware on a background thread. */
+#define MANYMOUSE_INIT_COALESCE_MOTION (1 << 1)  /* merge runs of RELMOTION. */
+#define MANYMOUSE_INIT_HOTPLUG (1 << 2)  /* report mice plugged in later. */
+#define MANYMOUSE_INIT_FRAMES (1 << 3)  /* one 2D motion event per report. */
+#define MANYMOUSE_INIT_EXCLUSIVE (1 << 4)  /* keep the mice from everyone else. */
+#define MANYMOUSE_INIT_ASYNC (1 << 5)  /* find mice in the background. */
+
 int ManyMouse_Init(void);
+int ManyMouse_InitEx(unsigned int flags);
+int ManyMouse_InitDriver(const char *name, unsigned int flags);
+const char *ManyMouse_ListDrivers(unsigned int index);
 const char *ManyMouse_DriverName(void);
 void ManyMouse_Quit(void);
 const char *ManyMouse_DeviceName(unsigned int index);
 int ManyMouse_PollEvent(ManyMouseEvent *event);
+int ManyMouse_PollEvents(ManyMouseEvent *events, unsigned int max);
+int ManyMouse_PollEventEx(ManyMouseEventEx *event);
+int ManyMouse_PollEventsEx(ManyMouseEventEx *events, unsigned int max);
+int ManyMouse_WaitEvent(ManyMouseEvent *event, int timeout_ms);
+int ManyMouse_ReadinessFD(void);
+void ManyMouse_Update(void);
+int ManyMouse_GetDeviceState(unsigned int index, ManyMouseDeviceState *state);
+int ManyMouse_DeviceStats(unsigned int index, ManyMouseStats *stats);
+int ManyMouse_DeviceInfo(unsigned int index, ManyMouseDeviceInfo *info);
+int ManyMouse_FindDevice(unsigned long long key);
+
+/*
+ * A context is a separate instance of all of the above: its own driver,
+ *  devices, event queue and device state. The functions above use a
+ *  default context that ManyMouse_Init() starts and ManyMouse_Quit()
+ *  stops. Each context is for one thread at a time, but different threads
+ *  can use different contexts at once.
+ */
+typedef struct ManyMouseContext ManyMouseContext;
+
+ManyMouseContext *ManyMouse_CreateContext(const char *driver, unsigned int flags, int *mice);
+void ManyMouse_DestroyContext(ManyMouseContext *ctx);
+const char *ManyMouse_ContextDriverName(ManyMouseContext *ctx);
+const char *ManyMouse_ContextDeviceName(ManyMouseContext *ctx, unsigned int index);
+int ManyMouse_ContextPollEvent(ManyMouseContext *ctx, ManyMouseEvent *event);
+int ManyMouse_ContextPollEvents(ManyMouseContext *ctx, ManyMouseEvent *events, unsigned int max);
+int ManyMouse_ContextPollEventEx(ManyMouseContext *ctx, ManyMouseEventEx *event);
+int ManyMouse_ContextPollEventsEx(ManyMouseContext *ctx, ManyMouseEventEx *events, unsigned int max);
+int ManyMouse_ContextWaitEvent(ManyMouseContext *ctx, ManyMouseEvent *event, int timeout_ms);
+int ManyMouse_ContextReadinessFD(ManyMouseContext *ctx);
+void ManyMouse_ContextUpdate(ManyMouseContext *ctx);
+int ManyMouse_ContextGetDeviceState(ManyMouseContext *ctx, unsigned int index, ManyMouseDeviceState *state);
+int ManyMouse_ContextDeviceStats(ManyMouseContext *ctx, unsigned int index, ManyMouseStats *stats);
+int ManyMouse_ContextDeviceInfo(ManyMouseContext *ctx, unsigned int index, ManyMouseDeviceInfo *info);
+int ManyMouse_ContextFindDevice(ManyMouseContext *ctx, unsigned long long key);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,335 @@
+/*
+ * ManyMouse event ring buffer. Drivers include this; apps shouldn't.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by Ryan C. Gordon.
+ */
+
+#ifndef _INCLUDE_MANYMOUSE_RING_H_
+#define _INCLUDE_MANYMOUSE_RING_H_
+
+#include <string.h>
+#include <stdatomic.h>
+
+#include "manymouse.h"
+
+/*
+ * This is a single-producer/single-consumer queue of events, which is what
+ *  every driver needs: something reads the hardware and queues events, and
+ *  the app's thread pulls them out in ManyMouse_PollEvent().
+ *
+ * The contract:
+ *  - Only one thread may push at a time, and only one thread may pop at a
+ *    time. They can be the same thread. If you hand either job to a
+ *    different thread, you need something like pthread_join() or a mutex
+ *    between the old thread and the new one.
+ *  - The producer only writes (tail), the consumer only writes (head).
+ *    In particular, the producer never moves (head) to make room; that's
+ *    a data race. When the ring is full, a push fails and the producer
+ *    decides what to do about it.
+ *  - Capacity must be a power of two. Indices run freely and wrap around
+ *    at UINT_MAX; (tail - head) is always the number of queued events.
+ *
+ * The producer publishes a slot with a release store to (tail), and the
+ *  consumer's acquire load of (tail) guarantees it sees the slot's contents.
+ *  Same thing in the other direction for (head), so the producer doesn't
+ *  reuse a slot that's still being copied out. (head) and (tail) live on
+ *  separate cache lines so the two threads don't fight over one.
+ */
+
+#define MANYMOUSE_CACHELINE 64
+
+typedef struct
+{
+    ManyMouseEventEx *events;
+    unsigned int mask;  /* capacity - 1 */
+    _Alignas(MANYMOUSE_CACHELINE) atomic_uint head;  /* consumer writes. */
+    _Alignas(MANYMOUSE_CACHELINE) atomic_uint tail;  /* producer writes. */
+} ManyMouseRing;
+
+/* Not thread safe. Do this before the producer or consumer start. */
+static inline void manymouse_ring_init(ManyMouseRing *ring,
+                                       ManyMouseEventEx *events,
+                                       const unsigned int capacity)
+{
+    ring->events = events;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+} /* manymouse_ring_init */
+
+/* Events queued. The other side may change this while you look at it. */
+static inline unsigned int manymouse_ring_count(ManyMouseRing *ring)
+{
+    const unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    const unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return tail - head;
+} /* manymouse_ring_count */
+
+/* Producer only. Free slots; the consumer can only make this grow. */
+static inline unsigned int manymouse_ring_space(ManyMouseRing *ring)
+{
+    const unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    const unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return (ring->mask + 1) - (tail - head);
+} /* manymouse_ring_space */
+
+/* Producer only. Returns zero if the ring is full and (event) wasn't queued. */
+static inline int manymouse_ring_push(ManyMouseRing *ring,
+                                      const ManyMouseEventEx *event)
+{
+    const unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    const unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if ((tail - head) > ring->mask)
+        return 0;  /* full. */
+
+    memcpy(&ring->events[tail & ring->mask], event, sizeof (*event));
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+} /* manymouse_ring_push */
+
+/* Consumer only. Copies out up to (max) events, returns how many it did. */
+static inline unsigned int manymouse_ring_pop(ManyMouseRing *ring,
+                                              ManyMouseEventEx *events,
+                                              const unsigned int max)
+{
+    const unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned int count = tail - head;
+    unsigned int i;
+
+    if (count > max)
+        count = max;
+
+    for (i = 0; i < count; i++)
+        memcpy(&events[i], &ring->events[(head + i) & ring->mask], sizeof (*events));
+
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+} /* manymouse_ring_pop */
+
+
+/*
+ * What to do when the ring fills up. Motion is the only thing we can afford
+ *  to lose, so once free space drops to the reserve, motion stops going in
+ *  and buttons, scrolling and disconnects get the rest of the ring to
+ *  themselves. Motion that's held back is merged per axis: relative deltas
+ *  are summed, absolute positions keep the latest one. 2D motion gets a
+ *  slot of its own, past the others, and is merged the same way. A finger
+ *  moving on a touch device is motion too; each contact gets a slot past
+ *  that, which keeps its latest position. Fingers touching down or
+ *  lifting are never held back, like buttons. When
+ *  there's room again, an OVERFLOW event for the device goes in first (its
+ *  value is how many samples were merged or dropped), then the held motion.
+ *
+ * Producers keep a ManyMouseBacklog per device, zeroed at startup, and
+ *  queue through manymouse_ring_queue() instead of manymouse_ring_push().
+ *  They should also stop reading once free space is down to the reserve,
+ *  and leave the rest with the system until the consumer makes room; as
+ *  long as what one read turns into fits in the reserve, nothing but
+ *  motion is ever dropped.
+ */
+#define MANYMOUSE_RING_RESERVE(ring) (((ring)->mask + 1) / 8)
+#define MANYMOUSE_BACKLOG_AXES 4  /* items past this are dropped, not merged. */
+#define MANYMOUSE_BACKLOG_TOUCHES 16  /* contacts past this are dropped, too. */
+#define MANYMOUSE_BACKLOG_2D MANYMOUSE_BACKLOG_AXES  /* slot for 2D motion. */
+#define MANYMOUSE_BACKLOG_TOUCH (MANYMOUSE_BACKLOG_2D + 1)  /* first contact's slot. */
+#define MANYMOUSE_BACKLOG_SLOTS (MANYMOUSE_BACKLOG_TOUCH + MANYMOUSE_BACKLOG_TOUCHES)
+
+typedef struct
+{
+    unsigned int lost;  /* samples merged or dropped since the last OVERFLOW. */
+    unsigned int held;  /* bit (i) is set if motion[i] is waiting. */
+    ManyMouseEventEx motion[MANYMOUSE_BACKLOG_SLOTS];
+} ManyMouseBacklog;
+
+static inline int manymouse_is_motion(const ManyMouseEventEx *event)
+{
+    return ((event->type == MANYMOUSE_EVENT_RELMOTION) ||
+            (event->type == MANYMOUSE_EVENT_ABSMOTION) ||
+            (event->type == MANYMOUSE_EVENT_RELMOTION2D) ||
+            (event->type == MANYMOUSE_EVENT_ABSMOTION2D) ||
+            ((event->type == MANYMOUSE_EVENT_TOUCH) &&
+             (event->item == MANYMOUSE_TOUCH_MOVE)));
+} /* manymouse_is_motion */
+
+static inline int manymouse_backlog_pending(const ManyMouseBacklog *backlog)
+{
+    return ((backlog->lost) || (backlog->held));
+} /* manymouse_backlog_pending */
+
+static inline unsigned int manymouse_backlog_size(const ManyMouseBacklog *b)
+{
+    unsigned int retval = (b->lost) ? 1 : 0;
+    unsigned int i;
+    for (i = 0; i < MANYMOUSE_BACKLOG_SLOTS; i++)
+        retval += (b->held >> i) & 1;
+    return retval;
+} /* manymouse_backlog_size */
+
+/* Which of backlog->motion[] (event) goes in, or MANYMOUSE_BACKLOG_SLOTS. */
+static inline unsigned int manymouse_backlog_slot(const ManyMouseBacklog *backlog,
+                                                  const ManyMouseEventEx *event)
+{
+    unsigned int freeslot = MANYMOUSE_BACKLOG_SLOTS;
+    unsigned int i;
+
+    if ((event->type == MANYMOUSE_EVENT_RELMOTION2D) ||
+        (event->type == MANYMOUSE_EVENT_ABSMOTION2D))
+        return MANYMOUSE_BACKLOG_2D;
+    else if (event->type != MANYMOUSE_EVENT_TOUCH)
+        return (event->item < MANYMOUSE_BACKLOG_AXES) ? event->item : MANYMOUSE_BACKLOG_SLOTS;
+
+    /* this contact's slot if it has one, else the first free one. */
+    for (i = MANYMOUSE_BACKLOG_TOUCH; i < MANYMOUSE_BACKLOG_SLOTS; i++)
+    {
+        if (!(backlog->held & (1 << i)))
+        {
+            if (freeslot == MANYMOUSE_BACKLOG_SLOTS)
+                freeslot = i;
+        } /* if */
+        else if (backlog->motion[i].contact == event->contact)
+            return i;
+    } /* for */
+
+    return freeslot;
+} /* manymouse_backlog_slot */
+
+static inline void manymouse_backlog_hold(ManyMouseBacklog *backlog,
+                                          const ManyMouseEventEx *event)
+{
+    const unsigned int slot = manymouse_backlog_slot(backlog, event);
+    const unsigned int bit = 1 << slot;
+    ManyMouseEventEx merged;
+    ManyMouseEventEx *held;
+
+    if (slot >= MANYMOUSE_BACKLOG_SLOTS)
+    {
+        backlog->lost++;
+        return;
+    } /* if */
+
+    held = &backlog->motion[slot];
+    if (!(backlog->held & bit))
+    {
+        memcpy(held, event, sizeof (*held));
+        backlog->held |= bit;
+        return;
+    } /* if */
+
+    backlog->lost++;  /* two samples become one. */
+    memcpy(&merged, event, sizeof (merged));
+    if (held->type != event->type)
+        { /* relative and absolute don't mix; the latest wins. */ }
+    else if (event->type == MANYMOUSE_EVENT_TOUCH)
+        { /* a finger is where it is now; the latest wins. */ }
+    else if (event->type == MANYMOUSE_EVENT_RELMOTION)
+        merged.value += held->value;
+    else if (event->type == MANYMOUSE_EVENT_RELMOTION2D)
+    {
+        merged.item |= held->item;
+        merged.value += held->value;
+        merged.value2 += held->value2;
+    } /* else if */
+    else if (event->type == MANYMOUSE_EVENT_ABSMOTION2D)
+    {
+        merged.item |= held->item;
+        if (!(event->item & 1))  /* keep the axis this one didn't move. */
+        {
+            merged.value = held->value;
+            merged.minval = held->minval;
+            merged.maxval = held->maxval;
+        } /* if */
+        if (!(event->item & 2))
+        {
+            merged.value2 = held->value2;
+            merged.minval2 = held->minval2;
+            merged.maxval2 = held->maxval2;
+        } /* if */
+    } /* else if */
+    memcpy(held, &merged, sizeof (*held));
+} /* manymouse_backlog_hold */
+
+/*
+ * Producer only. Queue (backlog) for (device) if that still leaves (keep)
+ *  free slots. Returns nonzero if nothing is held back anymore.
+ */
+static inline int manymouse_ring_flush(ManyMouseRing *ring,
+                                       ManyMouseBacklog *backlog,
+                                       const unsigned int device,
+                                       const unsigned int keep)
+{
+    unsigned int i;
+
+    if (!manymouse_backlog_pending(backlog))
+        return 1;
+    else if (manymouse_ring_space(ring) < manymouse_backlog_size(backlog) + keep)
+        return 0;
+
+    if (backlog->lost)
+    {
+        ManyMouseEventEx event;
+        memset(&event, '\0', sizeof (event));
+        event.version = MANYMOUSE_EVENTEX_VERSION;
+        event.type = MANYMOUSE_EVENT_OVERFLOW;
+        event.device = device;
+        event.value = (int) backlog->lost;
+        manymouse_ring_push(ring, &event);
+        backlog->lost = 0;
+    } /* if */
+
+    for (i = 0; i < MANYMOUSE_BACKLOG_SLOTS; i++)
+    {
+        if (backlog->held & (1 << i))
+            manymouse_ring_push(ring, &backlog->motion[i]);
+    } /* for */
+    backlog->held = 0;
+
+    return 1;
+} /* manymouse_ring_flush */
+
+/*
+ * Producer only. Queue (event) following the overflow policy above, with
+ *  (backlog) belonging to (event->device). Returns nonzero if anything
+ *  went into the ring.
+ */
+static inline int manymouse_ring_queue(ManyMouseRing *ring,
+                                       ManyMouseBacklog *backlog,
+                                       const ManyMouseEventEx *event)
+{
+    const unsigned int reserve = MANYMOUSE_RING_RESERVE(ring);
+    unsigned int i;
+
+    if (manymouse_is_motion(event))
+    {
+        if ((manymouse_ring_flush(ring, backlog, event->device, reserve + 1)) &&
+            (manymouse_ring_space(ring) > reserve))
+            return manymouse_ring_push(ring, event);
+        manymouse_backlog_hold(backlog, event);
+        return 0;
+    } /* if */
+
+    /* Held motion happened first, so it goes first...if it fits. */
+    if (!manymouse_ring_flush(ring, backlog, event->device, 1))
+    {
+        for (i = 0; i < MANYMOUSE_BACKLOG_SLOTS; i++)
+            backlog->lost += (backlog->held >> i) & 1;
+        backlog->held = 0;
+        manymouse_ring_flush(ring, backlog, event->device, 1);
+    } /* if */
+
+    if (!manymouse_ring_push(ring, event))
+    {
+        backlog->lost++;  /* completely full. Nothing else we can do. */
+        return 0;
+    } /* if */
+
+    return 1;
+} /* manymouse_ring_queue */
+
+#endif  /* !defined _INCLUDE_MANYMOUSE_RING_H_ */
+
+/* end of manymouse_ring.h ... */
+
@@ -40,6 +40,7 @@ static volatile int input_events_read = 0;
 static volatile int input_events_write = 0;
 static int available_mice = 0;
 static int did_api_lookup = 0;
+static int in_use = 0;
 static HWND raw_hwnd = NULL;
 static const char *class_name = "ManyMouseRawInputCatcher";
 static const char *win_name = "ManyMouseRawInputMsgWindow";
@@ -559,17 +560,23 @@ static void init_mouse(const RAWINPUTDEVICELIST *dev)
 } /* init_mouse */
 
 
-static int windows_wminput_init(void)
+static int windows_wminput_init(void **instance, unsigned int flags)
 {
     RAWINPUTDEVICELIST *devlist = NULL;
     UINT ct = 0;
     UINT i;
 
+    if (in_use)
+        return -1;  /* WM_INPUT only goes to one window per process. */
+
+    *instance = NULL;  /* everything's static; there can only be one. */
     available_mice = 0;
 
     if (!find_api_symbols())  /* only supported on WinXP and later. */
         return -1;
 
+    in_use = 1;
+
     pGetRawInputDeviceList(NULL, &ct, sizeof (RAWINPUTDEVICELIST));
     if (ct == 0)  /* no devices. */
         return 0;
@@ -589,7 +596,7 @@ static int windows_wminput_init(void)
 } /* windows_wminput_init */
 
 
-static void windows_wminput_quit(void)
+static void windows_wminput_quit(void *instance)
 {
     /* unregister WM_INPUT devices... */
     RAWINPUTDEVICE rid;
@@ -601,10 +608,11 @@ static void windows_wminput_quit(void)
     cleanup_window();
     available_mice = 0;
     pDeleteCriticalSection(&mutex);
+    in_use = 0;
 } /* windows_wminput_quit */
 
 
-static const char *windows_wminput_name(unsigned int index)
+static const char *windows_wminput_name(void *instance, unsigned int index)
 {
     return (index < available_mice) ? mice[index].name : NULL;
 } /* windows_wminput_name */
@@ -647,7 +655,7 @@ static int check_for_disconnects(ManyMouseEvent *ev)
 } /* check_for_disconnects */
 
 
-static int windows_wminput_poll(ManyMouseEvent *ev)
+static int windows_wminput_poll(void *instance, ManyMouseEvent *ev)
 {
     MSG Msg;  /* run the queue for WM_INPUT messages, etc ... */
     int found = 0;
@@ -700,7 +708,12 @@ static const ManyMouseDriver ManyMouseDriver_interface =
     windows_wminput_init,
     windows_wminput_quit,
     windows_wminput_name,
-    windows_wminput_poll
+    windows_wminput_poll,
+    NULL,  /* no native batch polling. */
+    NULL,  /* no native waiting. */
+    NULL,  /* no readiness fd. */
+    NULL,  /* no stats. */
+    NULL   /* no device info. */
 };
 
 const ManyMouseDriver *ManyMouseDriver_windows = &ManyMouseDriver_interface;
@@ -21,16 +21,22 @@
 
 #if SUPPORT_XINPUT2
 
+#include "manymouse_ring.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dlfcn.h>
-#include <sys/select.h>
+#include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
 #include <X11/extensions/XInput2.h>
 
 /* 32 is good enough for now. */
 #define MAX_MICE 32
 #define MAX_AXIS 16
+#define SCROLL_DIVISOR 120  /* smooth scrolling goes out in 120ths of a click. */
 typedef struct
 {
     int device_id;
@@ -38,55 +44,90 @@ typedef struct
     int relative[MAX_AXIS];
     int minval[MAX_AXIS];
     int maxval[MAX_AXIS];
+    int scroll[MAX_AXIS];  /* SCROLL item+1 for smooth scrolling axes, or 0. */
+    double increment[MAX_AXIS];  /* ...and how far one click moves them. */
+    int smooth[2];  /* nonzero if an axis scrolls this way, not buttons. */
+    ManyMouseBacklog backlog;  /* motion held back while input_ring is full. */
+    ManyMouseDeviceInfo info;  /* for ManyMouse_DeviceInfo(). */
     char name[64];
 } MouseStruct;
 
-static MouseStruct mice[MAX_MICE];
-static unsigned int available_mice = 0;
-
-static Display *display = NULL;
-static int xi2_opcode = 0;
-
+/* !!! FIXME: tweak this? */
+#define MAX_EVENTS 1024  /* must be a power of two. */
 
-/* !!! FIXME: this is cut-and-paste between a few targets now. Move it to
- * !!! FIXME:  manymouse.c ...
- */
 /*
- * Just trying to avoid malloc() here...we statically allocate a buffer
- *  for events and treat it as a ring buffer.
+ * Everything one ManyMouse context has open. Each context has its own
+ *  connection to the X server, which sends each of them its own copy of
+ *  the events.
  */
-/* !!! FIXME: tweak this? */
-#define MAX_EVENTS 1024
-static ManyMouseEvent input_events[MAX_EVENTS];
-static volatile int input_events_read = 0;
-static volatile int input_events_write = 0;
-
-static void queue_event(const ManyMouseEvent *event)
+typedef struct
 {
-    /* copy the event info. We'll process it in ManyMouse_PollEvent(). */
-    memcpy(&input_events[input_events_write], event, sizeof (ManyMouseEvent));
+    MouseStruct mice[MAX_MICE];
+    unsigned int available_mice;
+    Display *display;
+    int xi2_opcode;
+    int use_frames;  /* MANYMOUSE_INIT_FRAMES: x and y in one event. */
 
-    input_events_write = ((input_events_write + 1) % MAX_EVENTS);
+    /*
+     * We allocate a buffer for events along with everything else and treat
+     *  it as a ring buffer. pump_events() is the producer and
+     *  x11_xinput2_poll_batch() is the consumer.
+     */
+    ManyMouseRing input_ring;
+    ManyMouseEventEx input_events[MAX_EVENTS];
 
-    /* Ring buffer full? Lose oldest event. */
-    if (input_events_write == input_events_read)
-    {
-        /* !!! FIXME: we need to not lose mouse buttons here. */
-        input_events_read = ((input_events_read + 1) % MAX_EVENTS);
-    } /* if */
+    /*
+     * The X server stamps events with its own clock, in 32-bit
+     *  milliseconds. We map that onto CLOCK_MONOTONIC by tracking the
+     *  smallest difference we've seen between when the server said an
+     *  event happened and when we got it, which is our best guess at zero
+     *  latency. A local X server that uses CLOCK_MONOTONIC itself will
+     *  settle on an offset of about zero.
+     */
+    long long server_time_offset;
+    int server_time_offset_valid;
+    unsigned int server_time_last;
+    unsigned long long server_time_wraps;
+} ContextStruct;
+
+static void queue_event(ContextStruct *ctx, const ManyMouseEventEx *event)
+{
+    /* Ring buffer nearly full? Motion gets merged or lost, nothing else. */
+    manymouse_ring_queue(&ctx->input_ring, &ctx->mice[event->device].backlog, event);
 } /* queue_event */
 
+static unsigned long long monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (((unsigned long long) ts.tv_sec) * 1000000000ull) +
+           ((unsigned long long) ts.tv_nsec);
+} /* monotonic_ns */
 
-static int dequeue_event(ManyMouseEvent *event)
+static unsigned long long map_server_time(ContextStruct *ctx, const Time t)
 {
-    if (input_events_read != input_events_write)  /* no events if equal. */
+    const unsigned long long now = monotonic_ns();
+    const unsigned int ms = (unsigned int) t;  /* only 32 bits on the wire. */
+    unsigned long long server;
+    long long offset;
+
+    /* a big jump backwards means the server's counter wrapped around. */
+    if ((ctx->server_time_offset_valid) && (ms < ctx->server_time_last) &&
+        ((ctx->server_time_last - ms) > 0x80000000u))
+        ctx->server_time_wraps++;
+    ctx->server_time_last = ms;
+
+    server = ((ctx->server_time_wraps << 32) + ms) * 1000000ull;
+    offset = (long long) (now - server);
+    if ((!ctx->server_time_offset_valid) || (offset < ctx->server_time_offset))
     {
-        memcpy(event, &input_events[input_events_read], sizeof (*event));
-        input_events_read = ((input_events_read + 1) % MAX_EVENTS);
-        return 1;
+        ctx->server_time_offset = offset;
+        ctx->server_time_offset_valid = 1;
     } /* if */
-    return 0;  /* no event. */
-} /* dequeue_event */
+
+    server += (unsigned long long) ctx->server_time_offset;
+    return (server > now) ? now : server;
+} /* map_server_time */
 
 
 /*
@@ -108,6 +149,14 @@ static void *libx11 = NULL;
 static void *libxext = NULL;
 static void *libxi = NULL;
 
+/*
+ * The libraries and symbols are shared by every context, so they're loaded
+ *  by the first one and unloaded by the last. The Xext error handler is
+ *  one per process too, so swapping it out happens under api_lock as well.
+ */
+static pthread_mutex_t api_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int api_refcount = 0;
+
 typedef int (*XExtErrHandler)(Display *, _Xconst char *, _Xconst char *);
 
 static XExtErrHandler (*pXSetExtensionErrorHandler)(XExtErrHandler h) = 0;
@@ -124,6 +173,9 @@ static int (*pXNextEvent)(Display*,XEvent*) = 0;
 static int (*pXPending)(Display*) = 0;
 static int (*pXFlush)(Display*) = 0;
 static int (*pXEventsQueued)(Display*,int) = 0;
+static Atom (*pXInternAtom)(Display*,_Xconst char*,Bool) = 0;
+static int (*pXFree)(void*) = 0;
+static Status (*pXIGetProperty)(Display*,int,Atom,long,long,Bool,Atom,Atom*,int*,unsigned long*,unsigned long*,unsigned char**) = 0;
 
 static int symlookup(void *dll, void **addr, const char *sym)
 {
@@ -152,6 +204,8 @@ static int find_api_symbols(void)
     LOOKUP(XPending);
     LOOKUP(XFlush);
     LOOKUP(XEventsQueued);
+    LOOKUP(XInternAtom);
+    LOOKUP(XFree);
 
     dll = libxext = dlopen("libXext.so.6", RTLD_GLOBAL | RTLD_LAZY);
     if (dll == NULL)
@@ -167,6 +221,7 @@ static int find_api_symbols(void)
     LOOKUP(XIQueryVersion);
     LOOKUP(XIQueryDevice);
     LOOKUP(XIFreeDeviceInfo);
+    LOOKUP(XIGetProperty);
 
     #undef LOOKUP
 
@@ -174,29 +229,152 @@ static int find_api_symbols(void)
 } /* find_api_symbols */
 
 
-static void xinput2_cleanup(void)
+/* api_lock must be held. */
+static void close_api_libs(void)
 {
-    if (display != NULL)
-    {
-        pXCloseDisplay(display);
-        display = NULL;
-    } /* if */
-
-    memset(mice, '\0', sizeof (mice));
-    available_mice = 0;
-
     #define LIBCLOSE(lib) { if (lib != NULL) { dlclose(lib); lib = NULL; } }
     LIBCLOSE(libxi);
     LIBCLOSE(libxext);
     LIBCLOSE(libx11);
     #undef LIBCLOSE
+} /* close_api_libs */
+
+static int load_api(void)
+{
+    int retval = 1;
+    pthread_mutex_lock(&api_lock);
+    if ((api_refcount == 0) && (!find_api_symbols()))
+    {
+        close_api_libs();
+        retval = 0;
+    } /* if */
+    else
+        api_refcount++;
+    pthread_mutex_unlock(&api_lock);
+    return retval;
+} /* load_api */
 
-    memset(input_events, '\0', sizeof (input_events));
-    input_events_read = input_events_write = 0;
+static void unload_api(void)
+{
+    pthread_mutex_lock(&api_lock);
+    if (--api_refcount == 0)
+        close_api_libs();
+    pthread_mutex_unlock(&api_lock);
+} /* unload_api */
+
+
+static void xinput2_cleanup(ContextStruct *ctx)
+{
+    if (ctx->display != NULL)
+        pXCloseDisplay(ctx->display);
+    unload_api();
+    free(ctx);
 } /* xinput2_cleanup */
 
 
-static int init_mouse(MouseStruct *mouse, const XIDeviceInfo *devinfo)
+/* Fetch a device property. Free (*data) with pXFree() if this returns nonzero. */
+static int get_device_property(ContextStruct *ctx, const int devid,
+                               const char *name, const int format,
+                               unsigned long *count, unsigned char **data)
+{
+    const Atom prop = pXInternAtom(ctx->display, name, True);
+    unsigned long after = 0;
+    Atom type = None;
+    int realformat = 0;
+
+    *data = NULL;
+    if (prop == None)
+        return 0;  /* nobody has one of these. */
+    else if (pXIGetProperty(ctx->display, devid, prop, 0, 1024, False,
+                            AnyPropertyType, &type, &realformat, count,
+                            &after, data) != Success)
+        return 0;
+    else if (*data == NULL)
+        return 0;
+    else if ((realformat != format) || (*count == 0))
+    {
+        pXFree(*data);
+        return 0;
+    } /* else if */
+
+    return 1;
+} /* get_device_property */
+
+/* Read an attribute of an evdev node's device from sysfs, if it's there. */
+static void read_sysfs(const char *node, const char *attr, char *buf,
+                       const size_t len)
+{
+    const char *base = strrchr(node, '/');
+    char path[256];
+    FILE *io;
+
+    buf[0] = '\0';
+    snprintf(path, sizeof (path), "/sys/class/input/%s/device/%s",
+             base ? base + 1 : node, attr);
+    if ((io = fopen(path, "r")) == NULL)
+        return;
+    if (fgets(buf, (int) len, io) == NULL)
+        buf[0] = '\0';
+    fclose(io);
+    buf[strcspn(buf, "\n")] = '\0';
+} /* read_sysfs */
+
+/*
+ * X doesn't know much about the hardware, but the drivers behind most
+ *  devices set a "Device Node" property, and on Linux that gets us to
+ *  what the kernel knows, so keys match what the evdev driver makes.
+ */
+static void init_device_info(ContextStruct *ctx, MouseStruct *mouse)
+{
+    ManyMouseDeviceInfo *info = &mouse->info;
+    unsigned char *data = NULL;
+    unsigned long count = 0;
+
+    memset(info, '\0', sizeof (*info));
+    info->system_id = mouse->device_id;
+
+    if (get_device_property(ctx, mouse->device_id, "Device Product ID", 32, &count, &data))
+    {
+        if (count >= 2)  /* format 32 comes back as longs. */
+        {
+            info->vendor = (unsigned int) ((const long *) data)[0];
+            info->product = (unsigned int) ((const long *) data)[1];
+        } /* if */
+        pXFree(data);
+    } /* if */
+
+    if (get_device_property(ctx, mouse->device_id, "Device Node", 8, &count, &data))
+    {
+        const size_t len = (count < sizeof (info->node)) ? count : sizeof (info->node) - 1;
+        memcpy(info->node, data, len);
+        info->node[len] = '\0';
+        pXFree(data);
+    } /* if */
+
+    if (info->node[0])
+    {
+        char hex[16];
+        read_sysfs(info->node, "phys", info->phys, sizeof (info->phys));
+        read_sysfs(info->node, "uniq", info->uniq, sizeof (info->uniq));
+        read_sysfs(info->node, "id/bustype", hex, sizeof (hex));
+        if (hex[0])
+            info->bustype = (unsigned int) strtoul(hex, NULL, 16);
+        read_sysfs(info->node, "id/version", hex, sizeof (hex));
+        if (hex[0])
+            info->version = (unsigned int) strtoul(hex, NULL, 16);
+        if ((info->vendor == 0) && (info->product == 0))
+        {
+            read_sysfs(info->node, "id/vendor", hex, sizeof (hex));
+            info->vendor = (unsigned int) strtoul(hex, NULL, 16);
+            read_sysfs(info->node, "id/product", hex, sizeof (hex));
+            info->product = (unsigned int) strtoul(hex, NULL, 16);
+        } /* if */
+    } /* if */
+} /* init_device_info */
+
+
+static int init_mouse(ContextStruct *ctx, MouseStruct *mouse,
+                      const XIDeviceInfo *devinfo)
 {
     XIAnyClassInfo **classes = devinfo->classes;
     int axis = 0;
@@ -228,8 +406,25 @@ static int init_mouse(MouseStruct *mouse, const XIDeviceInfo *devinfo)
         } /* if */
     } /* for */
 
+    #ifdef XIScrollClass  /* XInput 2.1 and later. */
+    for (i = 0; i < devinfo->num_classes; i++)
+    {
+        if (classes[i]->type == XIScrollClass)
+        {
+            const XIScrollClassInfo *s = (XIScrollClassInfo*) classes[i];
+            const int item = (s->scroll_type == XIScrollTypeVertical) ? 0 : 1;
+            if ((s->number < 0) || (s->number >= MAX_AXIS) || (s->increment == 0.0))
+                continue;
+            mouse->scroll[s->number] = item + 1;
+            mouse->increment[s->number] = s->increment;
+            mouse->smooth[item] = 1;
+        } /* if */
+    } /* for */
+    #endif
+
     strncpy(mouse->name, devinfo->name, sizeof (mouse->name));
     mouse->name[sizeof (mouse->name) - 1] = '\0';
+    init_device_info(ctx, mouse);
     return 1;
 } /* init_mouse */
 
@@ -262,7 +457,7 @@ static int register_for_events(Display *dpy)
 } /* register_for_events */
 
 
-static int x11_xinput2_init_internal(void)
+static int x11_xinput2_init_internal(ContextStruct *ctx)
 {
     const char *ext = "XInputExtension";
     XIDeviceInfo *device_list = NULL;
@@ -271,26 +466,20 @@ static int x11_xinput2_init_internal(void)
     int event = 0;
     int error = 0;
     int major = 2;
-    int minor = 0;
+    int minor = 1;  /* 2.1 tells us about smooth scrolling; 2.0 servers still work. */
     int i = 0;
 
-    xinput2_cleanup();  /* just in case... */
-
-    if (getenv("MANYMOUSE_NO_XINPUT2") != NULL)
-        return -1;
-
-    if (!find_api_symbols())
-        return -1;  /* couldn't find all needed symbols. */
-
-    display = pXOpenDisplay(NULL);
-    if (display == NULL)
+    ctx->display = pXOpenDisplay(NULL);
+    if (ctx->display == NULL)
         return -1;  /* no X server at all */
 
+    pthread_mutex_lock(&api_lock);  /* the handler is everyone's. */
     Xext_handler = pXSetExtensionErrorHandler(xext_errhandler);
-    available = (pXQueryExtension(display, ext, &xi2_opcode, &event, &error) &&
-                 (pXIQueryVersion(display, &major, &minor) != BadRequest));
+    available = (pXQueryExtension(ctx->display, ext, &ctx->xi2_opcode, &event, &error) &&
+                 (pXIQueryVersion(ctx->display, &major, &minor) != BadRequest));
     pXSetExtensionErrorHandler(Xext_handler);
     Xext_handler = NULL;
+    pthread_mutex_unlock(&api_lock);
 
     if (!available)
         return -1;  /* no XInput2 support. */
@@ -300,49 +489,83 @@ static int x11_xinput2_init_internal(void)
      *  device between when we queried for the list and when we start
      *  listening for changes.
      */
-    if (!register_for_events(display))
+    if (!register_for_events(ctx->display))
         return -1;
 
-    device_list = pXIQueryDevice(display, XIAllDevices, &device_count);
+    device_list = pXIQueryDevice(ctx->display, XIAllDevices, &device_count);
     for (i = 0; i < device_count; i++)
     {
-        MouseStruct *mouse = &mice[available_mice];
-        if (init_mouse(mouse, &device_list[i]))
-            available_mice++;
+        MouseStruct *mouse = &ctx->mice[ctx->available_mice];
+        if (init_mouse(ctx, mouse, &device_list[i]))
+            ctx->available_mice++;
     } /* for */
     pXIFreeDeviceInfo(device_list);
 
-    return available_mice;
+    return ctx->available_mice;
 } /* x11_xinput2_init_internal */
 
 
-static int x11_xinput2_init(void)
+static int x11_xinput2_init(void **instance, unsigned int flags)
 {
-    int retval = x11_xinput2_init_internal();
+    ContextStruct *ctx;
+    void *ptr = NULL;
+    int retval;
+
+    if (getenv("MANYMOUSE_NO_XINPUT2") != NULL)
+        return -1;
+    else if (!load_api())
+        return -1;  /* couldn't find all needed symbols. */
+
+    /* input_ring wants its indices on their own cache lines. */
+    if (posix_memalign(&ptr, MANYMOUSE_CACHELINE, sizeof (*ctx)) != 0)
+    {
+        unload_api();
+        return -1;
+    } /* if */
+    ctx = (ContextStruct *) ptr;
+
+    memset(ctx, '\0', sizeof (*ctx));
+    manymouse_ring_init(&ctx->input_ring, ctx->input_events, MAX_EVENTS);
+    ctx->use_frames = ((flags & MANYMOUSE_INIT_FRAMES) != 0);
+    retval = x11_xinput2_init_internal(ctx);
     if (retval < 0)
-        xinput2_cleanup();
+        xinput2_cleanup(ctx);
+    else
+        *instance = ctx;
     return retval;
 } /* x11_xinput2_init */
 
 
-static void x11_xinput2_quit(void)
+static void x11_xinput2_quit(void *instance)
 {
-    xinput2_cleanup();
+    xinput2_cleanup((ContextStruct *) instance);
 } /* x11_xinput2_quit */
 
 
-static const char *x11_xinput2_name(unsigned int index)
+static const char *x11_xinput2_name(void *instance, unsigned int index)
 {
-    return (index < available_mice) ? mice[index].name : NULL;
+    const ContextStruct *ctx = (const ContextStruct *) instance;
+    return (index < ctx->available_mice) ? ctx->mice[index].name : NULL;
 } /* x11_xinput2_name */
 
 
-static int find_mouse_by_devid(const int devid)
+static int x11_xinput2_info(void *instance, unsigned int index,
+                            ManyMouseDeviceInfo *info)
+{
+    const ContextStruct *ctx = (const ContextStruct *) instance;
+    if (index >= ctx->available_mice)
+        return 0;
+    memcpy(info, &ctx->mice[index].info, sizeof (*info));
+    return 1;
+} /* x11_xinput2_info */
+
+
+static int find_mouse_by_devid(const ContextStruct *ctx, const int devid)
 {
     int i;
-    const MouseStruct *mouse = mice;
+    const MouseStruct *mouse = ctx->mice;
 
-    for (i = 0; i < available_mice; i++, mouse++)
+    for (i = 0; i < ctx->available_mice; i++, mouse++)
     {
         if (mouse->device_id == devid)
             return (mouse->connected) ? i : -1;
@@ -352,30 +575,38 @@ static int find_mouse_by_devid(const int devid)
 } /* find_mouse_by_devid */
 
 
-static int get_next_x11_event(XEvent *xev)
+/* returns >0 if the X connection has data to read, 0 on timeout, -1 error. */
+static int wait_for_x11_connection(ContextStruct *ctx, const int timeout_ms)
+{
+    struct pollfd pfd;
+    int rc;
+
+    pfd.fd = ConnectionNumber(ctx->display);
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    rc = poll(&pfd, 1, timeout_ms);
+    if (rc == -1)
+        return (errno == EINTR) ? 1 : -1;  /* signals just wake us early. */
+    return rc;
+} /* wait_for_x11_connection */
+
+
+static int get_next_x11_event(ContextStruct *ctx, XEvent *xev)
 {
     int available = 0;
 
-    pXFlush(display);
-    if (pXEventsQueued(display, QueuedAlready))
+    pXFlush(ctx->display);
+    if (pXEventsQueued(ctx->display, QueuedAlready))
         available = 1;
-    else
-    {
-        /* XPending() blocks if there's no data, so select() first. */
-        struct timeval nowait;
-        const int fd = ConnectionNumber(display);
-        fd_set fdset;
-        FD_ZERO(&fdset);
-        FD_SET(fd, &fdset);
-        memset(&nowait, '\0', sizeof (nowait));
-        if (select(fd+1, &fdset, NULL, NULL, &nowait) == 1)
-            available = pXPending(display);
-    } /* else */
+
+    /* XPending() blocks if there's no data, so check the socket first. */
+    else if (wait_for_x11_connection(ctx, 0) > 0)
+        available = pXPending(ctx->display);
 
     if (available)
     {
         memset(xev, '\0', sizeof (*xev));
-        pXNextEvent(display, xev);
+        pXNextEvent(ctx->display, xev);
         return 1;
     } /* if */
 
@@ -395,88 +626,155 @@ static inline int map_xi2_button(const int button)
 } /* map_xi2_button */
 
 
-static void pump_events(void)
+static void pump_events(ContextStruct *ctx)
 {
-    ManyMouseEvent event;
-    const int opcode = xi2_opcode;
+    ManyMouseEventEx event;
+    const int opcode = ctx->xi2_opcode;
     const XIRawEvent *rawev = NULL;
     const XIHierarchyEvent *hierev = NULL;
     int mouse = 0;
+    const unsigned int reserve = MANYMOUSE_RING_RESERVE(&ctx->input_ring);
     XEvent xev;
     int i = 0;
 
-    while (get_next_x11_event(&xev))
+    /* the app made room, so motion we held back can go in first. */
+    for (i = 0; i < (int) ctx->available_mice; i++)
+        manymouse_ring_flush(&ctx->input_ring, &ctx->mice[i].backlog, i, reserve);
+
+    /*
+     * Stop reading once we're into the reserve, and leave the rest with
+     *  Xlib until the app catches up; nothing's lost that way. The reserve
+     *  is there for what one X event can expand to.
+     */
+    while ((manymouse_ring_space(&ctx->input_ring) > reserve) &&
+           (get_next_x11_event(ctx, &xev)))
     {
         /* All XI2 events are "cookie" events...which need extra tapdance. */
         if (xev.xcookie.type != GenericEvent)
             continue;
         else if (xev.xcookie.extension != opcode)
             continue;
-        else if (!pXGetEventData(display, &xev.xcookie))
+        else if (!pXGetEventData(ctx->display, &xev.xcookie))
             continue;
 
+        memset(&event, '\0', sizeof (event));
+        event.version = MANYMOUSE_EVENTEX_VERSION;
+
         switch (xev.xcookie.evtype)
         {
             case XI_RawMotion:
                 rawev = (const XIRawEvent *) xev.xcookie.data;
-                mouse = find_mouse_by_devid(rawev->deviceid);
+                mouse = find_mouse_by_devid(ctx, rawev->deviceid);
                 if (mouse != -1)
                 {
+                    const MouseStruct *m = &ctx->mice[mouse];
+                    const unsigned long long ts = map_server_time(ctx, rawev->time);
                     const double *values = rawev->raw_values;
+                    const int framed = ((ctx->use_frames) && (m->relative[0] == m->relative[1]));
+                    ManyMouseEventEx frame;
                     int top = rawev->valuators.mask_len * 8;
                     if (top > MAX_AXIS)
                         top = MAX_AXIS;
 
+                    /* frames mode: x and y go out together, if they're alike. */
+                    memcpy(&frame, &event, sizeof (frame));
+                    if (framed)
+                    {
+                        if (m->relative[0])
+                            frame.type = MANYMOUSE_EVENT_RELMOTION2D;
+                        else
+                            frame.type = MANYMOUSE_EVENT_ABSMOTION2D;
+                        frame.device = mouse;
+                        frame.minval = m->minval[0];
+                        frame.maxval = m->maxval[0];
+                        frame.minval2 = m->minval[1];
+                        frame.maxval2 = m->maxval[1];
+                        frame.timestamp = ts;
+                    } /* if */
+
                     for (i = 0; i < top; i++)
                     {
                         if (XIMaskIsSet(rawev->valuators.mask, i))
                         {
-                            const int value = (int) *values;
-                            if (mice[mouse].relative[i])
+                            const double raw = *values;
+                            const int value = (int) raw;
+                            values++;
+                            if (m->scroll[i])
+                            {
+                                /* in 120ths of a click, and up/left is positive. */
+                                const double fine = -(raw / m->increment[i]) * SCROLL_DIVISOR;
+                                event.type = MANYMOUSE_EVENT_SCROLL;
+                                event.device = mouse;
+                                event.item = m->scroll[i] - 1;
+                                event.value = (int) ((fine < 0.0) ? (fine - 0.5) : (fine + 0.5));
+                                event.divisor = SCROLL_DIVISOR;
+                                event.timestamp = ts;
+                                if (event.value)
+                                    queue_event(ctx, &event);
+                                event.divisor = 0;
+                                continue;
+                            } /* if */
+                            else if ((m->relative[i]) && (!value))
+                                continue;  /* didn't move. */
+                            else if ((i < 2) && (framed))
+                            {
+                                frame.item |= 1 << i;
+                                if (i == 0)
+                                    frame.value = value;
+                                else
+                                    frame.value2 = value;
+                                continue;
+                            } /* else if */
+
+                            if (m->relative[i])
                                 event.type = MANYMOUSE_EVENT_RELMOTION;
                             else
                                 event.type = MANYMOUSE_EVENT_ABSMOTION;
                             event.device = mouse;
                             event.item = i;
                             event.value = value;
-                            event.minval = mice[mouse].minval[i];
-                            event.maxval = mice[mouse].maxval[i];
-                            if ((!mice[mouse].relative[i]) || (value))
-                                queue_event(&event);
-                            values++;
+                            event.minval = m->minval[i];
+                            event.maxval = m->maxval[i];
+                            event.timestamp = ts;
+                            queue_event(ctx, &event);
                         } /* if */
                     } /* for */
+
+                    if (frame.item)
+                        queue_event(ctx, &frame);
                 } /* if */
                 break;
 
             case XI_RawButtonPress:
             case XI_RawButtonRelease:
                 rawev = (const XIRawEvent *) xev.xcookie.data;
-                mouse = find_mouse_by_devid(rawev->deviceid);
+                mouse = find_mouse_by_devid(ctx, rawev->deviceid);
                 if (mouse != -1)
                 {
                     const int button = map_xi2_button(rawev->detail);
                     const int pressed = (xev.xcookie.evtype==XI_RawButtonPress);
 
+                    event.timestamp = map_server_time(ctx, rawev->time);
+
                     /* gah, XInput2 still maps the wheel to buttons. */
                     if ((button >= 4) && (button <= 7))
                     {
-                        if (pressed)  /* ignore "up" for these "buttons" */
+                        const int item = (button <= 5) ? 0 : 1;
+                        if (ctx->mice[mouse].smooth[item])
+                            { /* just emulation; we report the axis itself. */ }
+                        else if (pressed)  /* ignore "up" for these "buttons" */
                         {
                             event.type = MANYMOUSE_EVENT_SCROLL;
                             event.device = mouse;
-
-                            if ((button == 4) || (button == 5))
-                                event.item = 0;
-                            else
-                                event.item = 1;
+                            event.item = item;
+                            event.divisor = 1;
 
                             if ((button == 4) || (button == 6))
                                 event.value = 1;
                             else
                                 event.value = -1;
 
-                            queue_event(&event);
+                            queue_event(ctx, &event);
                         } /* if */
                     } /* if */
                     else
@@ -485,7 +783,7 @@ static void pump_events(void)
                         event.device = mouse;
                         event.item = button-1;
                         event.value = pressed;
-                        queue_event(&event);
+                        queue_event(ctx, &event);
                     } /* else */
                 } /* if */
                 break;
@@ -496,31 +794,68 @@ static void pump_events(void)
                 {
                     if (hierev->info[i].flags & XISlaveRemoved)
                     {
-                        mouse = find_mouse_by_devid(hierev->info[i].deviceid);
+                        mouse = find_mouse_by_devid(ctx, hierev->info[i].deviceid);
                         if (mouse != -1)
                         {
-                            mice[mouse].connected = 0;
+                            ctx->mice[mouse].connected = 0;
                             event.type = MANYMOUSE_EVENT_DISCONNECT;
+                            event.timestamp = map_server_time(ctx, hierev->time);
                             event.device = mouse;
-                            queue_event(&event);
+                            queue_event(ctx, &event);
                         } /* if */
                     } /* if */
                 } /* for */
                 break;
         } /* switch */
 
-        pXFreeEventData(display, &xev.xcookie);
+        pXFreeEventData(ctx->display, &xev.xcookie);
     } /* while */
 } /* pump_events */
 
-static int x11_xinput2_poll(ManyMouseEvent *event)
+static int x11_xinput2_poll_batch(void *instance, ManyMouseEventEx *events,
+                                  unsigned int max)
 {
-    if (dequeue_event(event))  /* ...favor existing events in the queue... */
-        return 1;
+    ContextStruct *ctx = (ContextStruct *) instance;
 
-    pump_events();  /* pump runloop for new hardware events... */
-    return dequeue_event(event);  /* see if anything had shown up... */
-} /* x11_xinput2_poll */
+    /* ...favor existing events in the queue... */
+    unsigned int count = manymouse_ring_pop(&ctx->input_ring, events, max);
+
+    if (count < max)
+    {
+        pump_events(ctx);  /* pump runloop for new hardware events... */
+        count += manymouse_ring_pop(&ctx->input_ring, events + count, max - count);
+    } /* if */
+
+    return (int) count;
+} /* x11_xinput2_poll_batch */
+
+
+static int x11_xinput2_wait(void *instance, int timeout_ms)
+{
+    ContextStruct *ctx = (ContextStruct *) instance;
+
+    if (manymouse_ring_count(&ctx->input_ring) > 0)
+        return 1;  /* already have something. */
+
+    pXFlush(ctx->display);
+    if (pXEventsQueued(ctx->display, QueuedAlready))
+        return 1;  /* Xlib read it already, we just haven't pumped it. */
+
+    return wait_for_x11_connection(ctx, timeout_ms);
+} /* x11_xinput2_wait */
+
+
+static int x11_xinput2_readiness_fd(void *instance)
+{
+    const ContextStruct *ctx = (const ContextStruct *) instance;
+
+    /*
+     * This is only readable when the X server sends something new, which
+     *  is why apps have to drain us completely before waiting on it: that
+     *  empties both our queue and Xlib's.
+     */
+    return ConnectionNumber(ctx->display);
+} /* x11_xinput2_readiness_fd */
 
 static const ManyMouseDriver ManyMouseDriver_interface =
 {
@@ -528,7 +863,12 @@ static const ManyMouseDriver ManyMouseDriver_interface =
     x11_xinput2_init,
     x11_xinput2_quit,
     x11_xinput2_name,
-    x11_xinput2_poll
+    NULL,  /* we only do batches. */
+    x11_xinput2_poll_batch,
+    x11_xinput2_wait,
+    x11_xinput2_readiness_fd,
+    NULL,  /* no stats. */
+    x11_xinput2_info
 };
 
 const ManyMouseDriver *ManyMouseDriver_xinput2 = &ManyMouseDriver_interface;